@@ -0,0 +1,432 @@
+/* audio.c
+ *
+ * PWM audio sample playback and voice mixer
+ *
+ * Two DMA channels, chained to each other, feed 8-bit samples from a pair
+ * of sample blocks into the PWM compare register at a DMA timer pace.
+ * The read ring wraps each channel back to the start of its block, so the
+ * playback runs with no interrupts at all. The mixer is called once per tick
+ * and fills the block that is not playing with the sum of all active voices.
+ *
+ */
+
+#include    <string.h>
+
+#include    "pico/stdlib.h"
+
+#include    "hardware/gpio.h"
+#include    "hardware/dma.h"
+#include    "hardware/clocks.h"
+#include    "hardware/pwm.h"
+
+#include    "audio.h"
+#include    "io.h"
+
+/* ----------------------------------------------------------------------------
+ * Module definitions
+ */
+#define     AUDIO_MIX_SHIFT     1           // Mixer head room, 4 voices at full volume will clip
+#define     AUDIO_NOISE_TAPS    0xb400      // 16-bit Galois LFSR
+
+typedef enum
+{
+    ENV_OFF,
+    ENV_ATTACK,
+    ENV_DECAY,
+    ENV_SUSTAIN,
+    ENV_RELEASE
+} env_stage_t;
+
+typedef struct
+{
+    audio_wave_t        wave;
+    const int8_t       *table;
+    uint32_t            phase;
+    uint32_t            phase_inc;
+    uint16_t            lfsr;
+    env_stage_t         stage;
+    int32_t             level;          // Envelope level, 8.8 fixed point
+    int32_t             target;         // Level at the end of the current stage
+    int32_t             ticks;          // Ticks left in the current stage
+    int32_t             peak;
+    int32_t             sustain;
+    uint8_t             decay;
+    uint8_t             release;
+} voice_t;
+
+/* ----------------------------------------------------------------------------
+ * Function prototypes
+ */
+static void audio_envelope(voice_t *voice);
+static void audio_mix_voice(voice_t *voice, int16_t *mix);
+
+/* ----------------------------------------------------------------------------
+ * Module globals
+ */
+static const int8_t audio_sine_table[256] =
+{
+       0,    3,    6,    9,   12,   16,   19,   22,   25,   28,   31,   34,   37,   40,   43,   46,
+      49,   51,   54,   57,   60,   63,   65,   68,   71,   73,   76,   78,   81,   83,   85,   88,
+      90,   92,   94,   96,   98,  100,  102,  104,  106,  107,  109,  111,  112,  113,  115,  116,
+     117,  118,  120,  121,  122,  122,  123,  124,  125,  125,  126,  126,  126,  127,  127,  127,
+     127,  127,  127,  127,  126,  126,  126,  125,  125,  124,  123,  122,  122,  121,  120,  118,
+     117,  116,  115,  113,  112,  111,  109,  107,  106,  104,  102,  100,   98,   96,   94,   92,
+      90,   88,   85,   83,   81,   78,   76,   73,   71,   68,   65,   63,   60,   57,   54,   51,
+      49,   46,   43,   40,   37,   34,   31,   28,   25,   22,   19,   16,   12,    9,    6,    3,
+       0,   -3,   -6,   -9,  -12,  -16,  -19,  -22,  -25,  -28,  -31,  -34,  -37,  -40,  -43,  -46,
+     -49,  -51,  -54,  -57,  -60,  -63,  -65,  -68,  -71,  -73,  -76,  -78,  -81,  -83,  -85,  -88,
+     -90,  -92,  -94,  -96,  -98, -100, -102, -104, -106, -107, -109, -111, -112, -113, -115, -116,
+    -117, -118, -120, -121, -122, -122, -123, -124, -125, -125, -126, -126, -126, -127, -127, -127,
+    -127, -127, -127, -127, -126, -126, -126, -125, -125, -124, -123, -122, -122, -121, -120, -118,
+    -117, -116, -115, -113, -112, -111, -109, -107, -106, -104, -102, -100,  -98,  -96,  -94,  -92,
+     -90,  -88,  -85,  -83,  -81,  -78,  -76,  -73,  -71,  -68,  -65,  -63,  -60,  -57,  -54,  -51,
+     -49,  -46,  -43,  -40,  -37,  -34,  -31,  -28,  -25,  -22,  -19,  -16,  -12,   -9,   -6,   -3,
+};
+
+static uint16_t     audio_buffer[2][AUDIO_BLOCK_LEN] __attribute__((aligned(2 * AUDIO_BLOCK_LEN * sizeof(uint16_t))));
+static int16_t      mix_buffer[AUDIO_BLOCK_LEN];
+static voice_t      voices[AUDIO_VOICES];
+static int          last_filled = -1;
+
+/***************************************************************
+ * audio_init()
+ *
+ *  Initialize PWM output, sample DMA channels and pacing timer.
+ *  Playback of silence starts immediately.
+ *
+ *  Param:  none
+ *  return: none
+ *
+ */
+void audio_init(void)
+{
+    dma_channel_config  c;
+    uint                pwm_slice_num;
+    volatile void      *pwm_level;
+    int                 i;
+
+    for ( i = 0; i < AUDIO_VOICES; i++ )
+    {
+        voices[i].stage = ENV_OFF;
+        voices[i].table = audio_sine_table;
+        voices[i].lfsr = 1;
+    }
+
+    for ( i = 0; i < AUDIO_BLOCK_LEN; i++ )
+    {
+        audio_buffer[0][i] = AUDIO_SILENCE;
+        audio_buffer[1][i] = AUDIO_SILENCE;
+    }
+
+    /* PWM carrier at full system clock rate,
+     * DMA writes both A and B levels with a 16-bit write.
+     */
+    gpio_set_function(PWM_OUTPUT_GPIO, GPIO_FUNC_PWM);
+    pwm_slice_num = pwm_gpio_to_slice_num(PWM_OUTPUT_GPIO);
+    pwm_set_clkdiv_int_frac(pwm_slice_num, 1, 0);
+    pwm_set_wrap(pwm_slice_num, AUDIO_PWM_WRAP);
+    pwm_set_chan_level(pwm_slice_num, PWM_CHAN_A, AUDIO_SILENCE);
+    pwm_set_enabled(pwm_slice_num, 1);
+
+    pwm_level = &pwm_hw->slice[pwm_slice_num].cc;
+
+    /* DMA timer paces the samples at the audio sample rate
+     */
+    dma_timer_claim(AUDIO_DMA_TIMER);
+    dma_timer_set_fraction(AUDIO_DMA_TIMER, 1, (clock_get_hz(clk_sys) / AUDIO_SAMPLE_RATE));
+
+    /* Two channels playing the two sample blocks back to back
+     */
+    dma_channel_claim(AUDIO_DMA_CHAN_A);
+    dma_channel_claim(AUDIO_DMA_CHAN_B);
+
+    c = dma_channel_get_default_config(AUDIO_DMA_CHAN_A);
+    channel_config_set_dreq(&c, dma_get_timer_dreq(AUDIO_DMA_TIMER));
+    channel_config_set_read_increment(&c, true);
+    channel_config_set_write_increment(&c, false);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_16);
+    channel_config_set_ring(&c, false, (AUDIO_BLOCK_BITS + 1));
+    channel_config_set_chain_to(&c, AUDIO_DMA_CHAN_B);
+    dma_channel_configure(AUDIO_DMA_CHAN_A, &c, pwm_level, audio_buffer[0], AUDIO_BLOCK_LEN, false);
+
+    c = dma_channel_get_default_config(AUDIO_DMA_CHAN_B);
+    channel_config_set_dreq(&c, dma_get_timer_dreq(AUDIO_DMA_TIMER));
+    channel_config_set_read_increment(&c, true);
+    channel_config_set_write_increment(&c, false);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_16);
+    channel_config_set_ring(&c, false, (AUDIO_BLOCK_BITS + 1));
+    channel_config_set_chain_to(&c, AUDIO_DMA_CHAN_A);
+    dma_channel_configure(AUDIO_DMA_CHAN_B, &c, pwm_level, audio_buffer[1], AUDIO_BLOCK_LEN, false);
+
+    dma_channel_start(AUDIO_DMA_CHAN_A);
+}
+
+/***************************************************************
+ * audio_mix()
+ *
+ *  Advance voice envelopes and mix all active voices into the
+ *  sample block that is not playing.
+ *  Call once per game tick. The block is only refilled after it was
+ *  played, so extra calls within the same block period do nothing.
+ *
+ *  Param:  none
+ *  return: none
+ *
+ */
+void audio_mix(void)
+{
+    int         playing;
+    int         free_block;
+    int         sample;
+    uint16_t   *out;
+    int         i;
+
+    playing = dma_channel_is_busy(AUDIO_DMA_CHAN_A) ? 0 : 1;
+    free_block = playing ^ 1;
+
+    if ( free_block == last_filled )
+        return;
+
+    memset(mix_buffer, 0, sizeof(mix_buffer));
+
+    for ( i = 0; i < AUDIO_VOICES; i++ )
+    {
+        audio_envelope(&voices[i]);
+
+        if ( voices[i].stage != ENV_OFF )
+            audio_mix_voice(&voices[i], mix_buffer);
+    }
+
+    out = audio_buffer[free_block];
+
+    for ( i = 0; i < AUDIO_BLOCK_LEN; i++ )
+    {
+        sample = AUDIO_SILENCE + (mix_buffer[i] >> AUDIO_MIX_SHIFT);
+
+        if ( sample < 0 )
+            sample = 0;
+        else if ( sample > AUDIO_PWM_WRAP )
+            sample = AUDIO_PWM_WRAP;
+
+        out[i] = sample;
+    }
+
+    last_filled = free_block;
+}
+
+/***************************************************************
+ * audio_voice_on()
+ *
+ *  Start a voice. The voice envelope starts its attack
+ *  and holds at the sustain level until audio_voice_off().
+ *
+ *  Param:  Voice number, wave form, frequency in Hz, peak volume,
+ *          and envelope (NULL for full volume with no attack or release)
+ *  return: none
+ *
+ */
+void audio_voice_on(int voice, audio_wave_t wave, uint32_t freq, uint8_t volume, const audio_envelope_t *envelope)
+{
+    voice_t    *v;
+
+    if ( voice < 0 || voice >= AUDIO_VOICES )
+        return;
+
+    v = &voices[voice];
+
+    v->wave = wave;
+    v->phase = 0;
+    audio_voice_set_freq(voice, freq);
+
+    v->peak = volume << 8;
+    v->level = 0;
+
+    if ( envelope )
+    {
+        v->sustain = (v->peak * envelope->sustain) >> 8;
+        v->decay = envelope->decay;
+        v->release = envelope->release;
+        v->ticks = envelope->attack;
+    }
+    else
+    {
+        v->sustain = v->peak;
+        v->decay = 0;
+        v->release = 0;
+        v->ticks = 0;
+    }
+
+    v->target = v->peak;
+    v->stage = ENV_ATTACK;
+}
+
+/***************************************************************
+ * audio_voice_off()
+ *
+ *  Start the release phase of a voice envelope.
+ *
+ *  Param:  Voice number
+ *  return: none
+ *
+ */
+void audio_voice_off(int voice)
+{
+    voice_t    *v;
+
+    if ( voice < 0 || voice >= AUDIO_VOICES )
+        return;
+
+    v = &voices[voice];
+
+    if ( v->stage == ENV_OFF || v->stage == ENV_RELEASE )
+        return;
+
+    v->target = 0;
+    v->ticks = v->release;
+    v->stage = ENV_RELEASE;
+}
+
+/***************************************************************
+ * audio_voice_set_freq()
+ *
+ *  Change voice frequency without restarting the envelope.
+ *
+ *  Param:  Voice number, frequency in Hz
+ *  return: none
+ *
+ */
+void audio_voice_set_freq(int voice, uint32_t freq)
+{
+    if ( voice < 0 || voice >= AUDIO_VOICES )
+        return;
+
+    voices[voice].phase_inc = (uint32_t)(((uint64_t) freq << 32) / AUDIO_SAMPLE_RATE);
+}
+
+/***************************************************************
+ * audio_voice_set_table()
+ *
+ *  Select a 256 sample wave table for an AUDIO_WAVETABLE voice.
+ *  Voices default to a sine wave table.
+ *
+ *  Param:  Voice number, wave table (NULL for sine wave)
+ *  return: none
+ *
+ */
+void audio_voice_set_table(int voice, const int8_t *table)
+{
+    if ( voice < 0 || voice >= AUDIO_VOICES )
+        return;
+
+    voices[voice].table = table ? table : audio_sine_table;
+}
+
+/***************************************************************
+ * audio_voice_is_active()
+ *
+ *  Check if a voice is playing, including its release phase.
+ *
+ *  Param:  Voice number
+ *  return: 1 if voice is playing, 0 if not
+ *
+ */
+int audio_voice_is_active(int voice)
+{
+    if ( voice < 0 || voice >= AUDIO_VOICES )
+        return 0;
+
+    return (voices[voice].stage != ENV_OFF);
+}
+
+/* ----------------------------------------------------------------------------
+ * audio_envelope()
+ *
+ *  Advance the voice envelope by one tick. The level ramps linearly
+ *  toward the stage target and is held constant within a sample block.
+ *
+ *  Param:  Voice
+ *  return: none
+ *
+ */
+static void audio_envelope(voice_t *voice)
+{
+    while ( voice->ticks == 0 )
+    {
+        voice->level = voice->target;
+
+        switch ( voice->stage )
+        {
+        case ENV_ATTACK:
+            voice->stage = ENV_DECAY;
+            voice->target = voice->sustain;
+            voice->ticks = voice->decay;
+            break;
+
+        case ENV_DECAY:
+            voice->stage = ENV_SUSTAIN;
+            return;
+
+        case ENV_RELEASE:
+            voice->stage = ENV_OFF;
+            return;
+
+        default:
+            return;
+        }
+    }
+
+    voice->level += (voice->target - voice->level) / voice->ticks;
+    voice->ticks--;
+}
+
+/* ----------------------------------------------------------------------------
+ * audio_mix_voice()
+ *
+ *  Add one block of voice samples into the mix buffer.
+ *
+ *  Param:  Voice and mix buffer
+ *  return: none
+ *
+ */
+static void audio_mix_voice(voice_t *voice, int16_t *mix)
+{
+    uint32_t    phase = voice->phase;
+    uint32_t    phase_inc = voice->phase_inc;
+    int         volume = voice->level >> 8;
+    int         amplitude = (127 * volume) >> 8;
+    uint16_t    lfsr;
+    int         i;
+
+    switch ( voice->wave )
+    {
+    case AUDIO_SQUARE:
+        for ( i = 0; i < AUDIO_BLOCK_LEN; i++ )
+        {
+            mix[i] += (phase & 0x80000000) ? amplitude : -amplitude;
+            phase += phase_inc;
+        }
+        break;
+
+    case AUDIO_NOISE:
+        lfsr = voice->lfsr;
+        for ( i = 0; i < AUDIO_BLOCK_LEN; i++ )
+        {
+            mix[i] += (lfsr & 1) ? amplitude : -amplitude;
+            phase += phase_inc;
+            if ( phase < phase_inc )
+                lfsr = (lfsr >> 1) ^ (-(lfsr & 1) & AUDIO_NOISE_TAPS);
+        }
+        voice->lfsr = lfsr;
+        break;
+
+    case AUDIO_WAVETABLE:
+        for ( i = 0; i < AUDIO_BLOCK_LEN; i++ )
+        {
+            mix[i] += (voice->table[phase >> 24] * volume) >> 8;
+            phase += phase_inc;
+        }
+        break;
+    }
+
+    voice->phase = phase;
+}
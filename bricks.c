@@ -0,0 +1,196 @@
+/* bricks.c
+ *
+ * Brick wall occupancy and collision
+ *
+ * The wall is a grid of cells with power of two width and height.
+ * Occupancy is a packed bitset, one 32 bit word per grid row with a bit
+ * per column, so a collision test turns a bounding box into a cell range
+ * and tests a few masked row words, whatever the number of bricks.
+ * The module does not draw and has no hardware dependencies,
+ * so it also builds on the host (see tools/bricks_bench.c).
+ *
+ */
+
+#include    <string.h>
+
+#include    "bricks.h"
+
+/* ----------------------------------------------------------------------------
+ * Module definitions
+ */
+
+/* ----------------------------------------------------------------------------
+ * Function prototypes
+ */
+static uint32_t bricks_col_mask(int first, int last);
+
+/***************************************************************
+ * bricks_init()
+ *
+ *  Initialize an empty brick wall
+ *
+ *  Param:  Wall, top left corner in pixels, cell width and height
+ *          as powers of two, columns (up to BRICKS_MAX_COLS) and rows (up to BRICKS_MAX_ROWS)
+ *  return: none
+ *
+ */
+void bricks_init(bricks_t *wall, int x0, int y0, int col_shift, int row_shift, int cols, int rows)
+{
+    memset(wall->row, 0, sizeof(wall->row));
+
+    wall->x0 = x0;
+    wall->y0 = y0;
+    wall->col_shift = col_shift;
+    wall->row_shift = row_shift;
+    wall->cols = (cols > BRICKS_MAX_COLS) ? BRICKS_MAX_COLS : cols;
+    wall->rows = (rows > BRICKS_MAX_ROWS) ? BRICKS_MAX_ROWS : rows;
+    wall->count = 0;
+}
+
+/***************************************************************
+ * bricks_fill()
+ *
+ *  Place a brick in every cell of the wall
+ *
+ *  Param:  Wall
+ *  return: none
+ *
+ */
+void bricks_fill(bricks_t *wall)
+{
+    uint32_t    mask = bricks_col_mask(0, wall->cols - 1);
+
+    for ( int r = 0; r < wall->rows; r++ )
+        wall->row[r] = mask;
+
+    wall->count = wall->cols * wall->rows;
+}
+
+/***************************************************************
+ * bricks_test()
+ *
+ *  Test if a cell has a brick
+ *
+ *  Param:  Wall, cell column and row
+ *  return: 1 if there is a brick, 0 if not or outside the wall
+ *
+ */
+int bricks_test(const bricks_t *wall, int col, int row)
+{
+    if ( col < 0 || col >= wall->cols || row < 0 || row >= wall->rows )
+        return 0;
+
+    return (wall->row[row] >> col) & 1;
+}
+
+/***************************************************************
+ * bricks_clear()
+ *
+ *  Remove a brick
+ *
+ *  Param:  Wall, cell column and row
+ *  return: none
+ *
+ */
+void bricks_clear(bricks_t *wall, int col, int row)
+{
+    if ( !bricks_test(wall, col, row) )
+        return;
+
+    wall->row[row] &= ~(1UL << col);
+    wall->count--;
+}
+
+/***************************************************************
+ * bricks_count()
+ *
+ *  Return the number of bricks in the wall
+ *
+ *  Param:  Wall
+ *  return: Brick count
+ *
+ */
+int bricks_count(const bricks_t *wall)
+{
+    return wall->count;
+}
+
+/***************************************************************
+ * bricks_collide()
+ *
+ *  Find and remove a brick that overlaps a bounding box.
+ *  Pass the ball's swept bounding box, covering its position before and
+ *  after the move, so a fast ball does not pass through a brick.
+ *  Only the cells under the box are tested, one masked row word per
+ *  cell row, so the cost depends on the box size and not on the bricks.
+ *
+ *  Param:  Wall, bounding box corners (x0,y0)-(x1,y1) in pixels,
+ *          pointers to column and row of the removed brick
+ *  return: 1 if a brick was hit and removed, 0 if not
+ *
+ */
+int bricks_collide(bricks_t *wall, int x0, int y0, int x1, int y1, int *col, int *row)
+{
+    int         c0, c1, r0, r1;
+    uint32_t    mask;
+    uint32_t    hit;
+
+    /* Bounding box to cell range, clipped to the wall
+     */
+    x0 -= wall->x0;
+    x1 -= wall->x0;
+    y0 -= wall->y0;
+    y1 -= wall->y0;
+
+    if ( x1 < 0 || y1 < 0 )
+        return 0;
+
+    c0 = (x0 < 0) ? 0 : (x0 >> wall->col_shift);
+    c1 = x1 >> wall->col_shift;
+    r0 = (y0 < 0) ? 0 : (y0 >> wall->row_shift);
+    r1 = y1 >> wall->row_shift;
+
+    if ( c0 >= wall->cols || r0 >= wall->rows )
+        return 0;
+
+    if ( c1 >= wall->cols )
+        c1 = wall->cols - 1;
+    if ( r1 >= wall->rows )
+        r1 = wall->rows - 1;
+
+    mask = bricks_col_mask(c0, c1);
+
+    for ( int r = r0; r <= r1; r++ )
+    {
+        hit = wall->row[r] & mask;
+
+        if ( hit )
+        {
+            *col = __builtin_ctz(hit);
+            *row = r;
+            wall->row[r] &= ~(1UL << *col);
+            wall->count--;
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/* ----------------------------------------------------------------------------
+ * bricks_col_mask()
+ *
+ *  Occupancy bits of a column range
+ *
+ *  Param:  First and last column
+ *  return: Mask with bits 'first' to 'last' set
+ *
+ */
+static uint32_t bricks_col_mask(int first, int last)
+{
+    uint32_t    mask;
+
+    mask = (last >= 31) ? 0xffffffff : ((1UL << (last + 1)) - 1);
+
+    return mask & ~((1UL << first) - 1);
+}
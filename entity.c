@@ -0,0 +1,278 @@
+/* entity.c
+ *
+ * Moving object (entity) store
+ *
+ * Entities are kept in structure-of-arrays layout: each attribute is an array
+ * indexed by entity number, and the live entities are always packed at the start.
+ * The update loop only touches the position and velocity arrays, and the draw
+ * loop only the position, image and sprite arrays, so each loop streams through
+ * contiguous memory instead of striding over whole entity records.
+ * Position and velocity are fixed point with ENTITY_FRAC_BITS fraction bits,
+ * velocity is in pixels per tick.
+ *
+ */
+
+#include    "pico.h"
+
+#include    "entity.h"
+#include    "video.h"
+#include    "io.h"
+
+/* ----------------------------------------------------------------------------
+ * Module definitions
+ */
+
+/* ----------------------------------------------------------------------------
+ * Function prototypes
+ */
+
+/* ----------------------------------------------------------------------------
+ * Module globals
+ */
+static int              count = 0;
+
+static int32_t          pos_x[ENTITY_MAX];          // Top left corner
+static int32_t          pos_y[ENTITY_MAX];
+static int32_t          vel_x[ENTITY_MAX];
+static int32_t          vel_y[ENTITY_MAX];
+static const bit_blit_t *image[ENTITY_MAX];
+static uint8_t          sprite[ENTITY_MAX];         // Video sprite number or ENTITY_NO_SPRITE
+
+/***************************************************************
+ * entity_init()
+ *
+ *  Remove all entities
+ *
+ *  Param:  none
+ *  return: none
+ *
+ */
+void entity_init(void)
+{
+    count = 0;
+}
+
+/***************************************************************
+ * entity_add()
+ *
+ *  Add an entity to the store.
+ *  An entity with a sprite number moves that video sprite, the sprite
+ *  must be set and enabled by the caller. An entity with ENTITY_NO_SPRITE
+ *  is bit blitted into the drawing plane by entity_draw().
+ *
+ *  Param:  Fixed point top left position and velocity per tick, image, sprite number
+ *  return: Entity number, -1 if the store is full
+ *
+ */
+int entity_add(int32_t x, int32_t y, int32_t vx, int32_t vy, const bit_blit_t *img, uint8_t spr)
+{
+    if ( count >= ENTITY_MAX )
+        return -1;
+
+    pos_x[count] = x;
+    pos_y[count] = y;
+    vel_x[count] = vx;
+    vel_y[count] = vy;
+    image[count] = img;
+    sprite[count] = spr;
+
+    return count++;
+}
+
+/***************************************************************
+ * entity_remove()
+ *
+ *  Remove an entity. The last entity is moved into its place,
+ *  so entity numbers above the removed one are not stable.
+ *
+ *  Param:  Entity number
+ *  return: none
+ *
+ */
+void entity_remove(int entity)
+{
+    if ( entity < 0 || entity >= count )
+        return;
+
+    count--;
+
+    pos_x[entity] = pos_x[count];
+    pos_y[entity] = pos_y[count];
+    vel_x[entity] = vel_x[count];
+    vel_y[entity] = vel_y[count];
+    image[entity] = image[count];
+    sprite[entity] = sprite[count];
+}
+
+/***************************************************************
+ * entity_count()
+ *
+ *  Return the number of entities in the store
+ *
+ *  Param:  none
+ *  return: Entity count
+ *
+ */
+int entity_count(void)
+{
+    return count;
+}
+
+/***************************************************************
+ * entity_get_pos()
+ *
+ *  Return an entity's top left position in pixels
+ *
+ *  Param:  Entity number, pointers to x and y
+ *  return: none
+ *
+ */
+void entity_get_pos(int entity, int *x, int *y)
+{
+    if ( entity < 0 || entity >= count )
+        return;
+
+    *x = ENTITY_TO_PIXEL(pos_x[entity]);
+    *y = ENTITY_TO_PIXEL(pos_y[entity]);
+}
+
+/***************************************************************
+ * entity_set_pos()
+ *
+ *  Move an entity
+ *
+ *  Param:  Entity number, fixed point top left position
+ *  return: none
+ *
+ */
+void entity_set_pos(int entity, int32_t x, int32_t y)
+{
+    if ( entity < 0 || entity >= count )
+        return;
+
+    pos_x[entity] = x;
+    pos_y[entity] = y;
+}
+
+/***************************************************************
+ * entity_get_vel()
+ *
+ *  Return an entity's velocity
+ *
+ *  Param:  Entity number, pointers to fixed point velocity per tick
+ *  return: none
+ *
+ */
+void entity_get_vel(int entity, int32_t *vx, int32_t *vy)
+{
+    if ( entity < 0 || entity >= count )
+        return;
+
+    *vx = vel_x[entity];
+    *vy = vel_y[entity];
+}
+
+/***************************************************************
+ * entity_set_vel()
+ *
+ *  Change an entity's velocity
+ *
+ *  Param:  Entity number, fixed point velocity per tick
+ *  return: none
+ *
+ */
+void entity_set_vel(int entity, int32_t vx, int32_t vy)
+{
+    if ( entity < 0 || entity >= count )
+        return;
+
+    vel_x[entity] = vx;
+    vel_y[entity] = vy;
+}
+
+/***************************************************************
+ * entity_update()
+ *
+ *  Move all entities one tick, and bounce them off the edges
+ *  of a bounding box. The box limits the top left corner of
+ *  the entities, so the caller accounts for image size.
+ *
+ *  Param:  Bounding box for entity top left corner, in pixels
+ *  return: none
+ *
+ */
+void __not_in_flash_func(entity_update)(int x_min, int y_min, int x_max, int y_max)
+{
+    int32_t     x0 = ENTITY_TO_FIXED(x_min);
+    int32_t     y0 = ENTITY_TO_FIXED(y_min);
+    int32_t     x1 = ENTITY_TO_FIXED(x_max);
+    int32_t     y1 = ENTITY_TO_FIXED(y_max);
+    int32_t     p;
+
+    for ( int i = 0; i < count; i++ )
+    {
+        p = pos_x[i] + vel_x[i];
+
+        if ( p < x0 )
+        {
+            p = 2 * x0 - p;
+            vel_x[i] = -vel_x[i];
+        }
+        else if ( p > x1 )
+        {
+            p = 2 * x1 - p;
+            vel_x[i] = -vel_x[i];
+        }
+
+        pos_x[i] = p;
+    }
+
+    for ( int i = 0; i < count; i++ )
+    {
+        p = pos_y[i] + vel_y[i];
+
+        if ( p < y0 )
+        {
+            p = 2 * y0 - p;
+            vel_y[i] = -vel_y[i];
+        }
+        else if ( p > y1 )
+        {
+            p = 2 * y1 - p;
+            vel_y[i] = -vel_y[i];
+        }
+
+        pos_y[i] = p;
+    }
+}
+
+/***************************************************************
+ * entity_draw()
+ *
+ *  Move the video sprites of sprite entities, and bit blit
+ *  the other entities into the drawing plane with the default
+ *  pixel action. A bit blit waits for vertical retrace, so entities
+ *  that are not blitted before the retrace ends are skipped for this
+ *  frame instead of waiting for the next one.
+ *
+ *  Param:  none
+ *  return: Number of entities bit blitted
+ *
+ */
+int __not_in_flash_func(entity_draw)(void)
+{
+    int     blits = 0;
+
+    for ( int i = 0; i < count; i++ )
+    {
+        if ( sprite[i] != ENTITY_NO_SPRITE )
+            video_sprite_move(sprite[i], ENTITY_TO_PIXEL(pos_x[i]), ENTITY_TO_PIXEL(pos_y[i]));
+        else if ( io_is_vert_retrace() )
+        {
+            video_bit_blit(ENTITY_TO_PIXEL(pos_x[i]), ENTITY_TO_PIXEL(pos_y[i]), image[i]);
+            blits++;
+        }
+    }
+
+    return blits;
+}
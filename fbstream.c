@@ -0,0 +1,250 @@
+/* fbstream.c
+ *
+ * Frame buffer streaming over the stdio UART
+ *
+ * Every tick, each frame buffer row is composed as it is shown on screen
+ * (planes and sprites) and hashed. Rows whose hash differs from the last
+ * row sent are queued to the UART transmit DMA as run length encoded line
+ * packets, after a frame packet. The first frame sends every row (the key
+ * frame), after that only changed rows are sent. Rows that do not fit in the
+ * tick's share of the UART bandwidth stay pending for the next tick.
+ * One row per tick is sent even if it did not change, so a receiver that
+ * joins late, or lost a packet, is fully refreshed within a few seconds.
+ *
+ * Packets are framed by serial_write_packet(), numbers in the payload are
+ * little endian and line pixels use the video_rle_t run format.
+ * Packets are decoded by tools/fbstream_decode.py.
+ *
+ */
+
+#include    <string.h>
+
+#include    "pico.h"
+
+#include    "fbstream.h"
+#include    "serial.h"
+#include    "scanline.h"
+#include    "video.h"
+#include    "io.h"
+
+/* ----------------------------------------------------------------------------
+ * Module definitions
+ */
+#define     LINE_RLE_MAX            ((VIDEO_X_RESOLUTION * 2) + 2)  // Run length bytes in the worst case line
+
+/* ----------------------------------------------------------------------------
+ * Function prototypes
+ */
+static uint32_t fbstream_hash(const uint32_t *pixels);
+static int      fbstream_rle(const uint32_t *pixels, uint8_t *data);
+
+/* ----------------------------------------------------------------------------
+ * Module globals
+ */
+static uint32_t             sent_hash[VIDEO_Y_RESOLUTION];
+static uint8_t              row_dirty[VIDEO_Y_RESOLUTION];
+static uint32_t             refresh_row = 0;
+static uint32_t             next_row = 0;           // First row to try next tick, so rows are not starved
+static uint32_t             line[SCAN_LINE_BUF_LEN];
+static fbstream_stats_t     stats;
+
+/***************************************************************
+ * fbstream_init()
+ *
+ *  Initialize the stream, the next frame is a key frame.
+ *  Call after serial_init().
+ *
+ *  Param:  none
+ *  return: none
+ *
+ */
+void fbstream_init(void)
+{
+    memset(&stats, 0, sizeof(stats));
+    memset(row_dirty, 1, sizeof(row_dirty));
+    refresh_row = 0;
+    next_row = 0;
+}
+
+/***************************************************************
+ * fbstream()
+ *
+ *  Find changed rows and queue them for transmit,
+ *  run as a background task once per tick.
+ *
+ *  Param:  none
+ *  return: none
+ *
+ */
+void fbstream(void)
+{
+    uint8_t     frame[8];
+    uint8_t     rle[2 + LINE_RLE_MAX];
+    uint32_t   *pixels;
+    uint32_t    hash;
+    uint32_t    budget;
+    uint32_t    frame_bytes = 0;
+    uint32_t    row;
+    uint32_t    tick;
+    int         len;
+
+    /* Changed rows, and one refreshed row
+     */
+    for ( row = 0; row < VIDEO_Y_RESOLUTION; row++ )
+    {
+        pixels = video_read_line(row, line);
+        hash = fbstream_hash(pixels);
+
+        if ( hash != sent_hash[row] )
+            row_dirty[row] = 1;
+    }
+
+    row_dirty[refresh_row] = 1;
+    refresh_row = (refresh_row + 1) % VIDEO_Y_RESOLUTION;
+
+    /* Send in row order from where the last tick stopped,
+     * within this tick's bandwidth
+     */
+    budget = (serial_bytes_per_tick() * FBSTREAM_BANDWIDTH) / 100;
+    stats.rows_pending = 0;
+
+    for ( uint32_t i = 0; i < VIDEO_Y_RESOLUTION; i++ )
+    {
+        row = (next_row + i) % VIDEO_Y_RESOLUTION;
+
+        if ( !row_dirty[row] )
+            continue;
+
+        pixels = video_read_line(row, line);
+
+        rle[0] = row & 0xff;
+        rle[1] = row >> 8;
+        len = 2 + fbstream_rle(pixels, &rle[2]);
+
+        if ( frame_bytes == 0 )
+        {
+            tick = io_get_tick_count();
+            memcpy(frame, &tick, 4);
+            frame[4] = VIDEO_X_RESOLUTION & 0xff;
+            frame[5] = VIDEO_X_RESOLUTION >> 8;
+            frame[6] = VIDEO_Y_RESOLUTION & 0xff;
+            frame[7] = VIDEO_Y_RESOLUTION >> 8;
+
+            if ( !serial_write_packet(FBSTREAM_FRAME, frame, sizeof(frame)) )
+                break;
+
+            frame_bytes = SERIAL_PACKET_HEADER + sizeof(frame) + 1;
+        }
+
+        if ( (frame_bytes + SERIAL_PACKET_HEADER + len + 1) > budget && frame_bytes > (SERIAL_PACKET_HEADER + sizeof(frame) + 1) )
+        {
+            next_row = row;
+            break;
+        }
+
+        if ( !serial_write_packet(FBSTREAM_LINE, rle, len) )
+        {
+            next_row = row;
+            break;
+        }
+
+        frame_bytes += SERIAL_PACKET_HEADER + len + 1;
+        sent_hash[row] = fbstream_hash(pixels);
+        row_dirty[row] = 0;
+    }
+
+    for ( row = 0; row < VIDEO_Y_RESOLUTION; row++ )
+        stats.rows_pending += row_dirty[row];
+
+    stats.frames++;
+    stats.bytes += frame_bytes;
+    if ( frame_bytes > stats.max_frame_bytes )
+        stats.max_frame_bytes = frame_bytes;
+}
+
+/***************************************************************
+ * fbstream_get_stats()
+ *
+ *  Return stream statistics
+ *
+ *  Param:  Pointer to statistics
+ *  return: none
+ *
+ */
+void fbstream_get_stats(fbstream_stats_t *s)
+{
+    *s = stats;
+}
+
+/* ----------------------------------------------------------------------------
+ * fbstream_hash()
+ *
+ *  FNV-1a hash of the pixels of a line
+ *
+ *  Param:  Active video words of a line
+ *  return: Hash
+ *
+ */
+static uint32_t fbstream_hash(const uint32_t *pixels)
+{
+    uint32_t    hash = 2166136261u;
+
+    for ( int w = 0; w < VIDEO_ACTIVE_WORDS; w++ )
+    {
+        hash ^= pixels[w] >> 16;
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+/* ----------------------------------------------------------------------------
+ * fbstream_rle()
+ *
+ *  Run length encode the pixels of a line, alternating black and white
+ *  runs starting with black, each run length an unsigned LEB128 number.
+ *  Words of 16 pixels that continue the current run are counted whole.
+ *
+ *  Param:  Active video words of a line, output buffer of LINE_RLE_MAX bytes
+ *  return: Encoded length in bytes
+ *
+ */
+static int fbstream_rle(const uint32_t *pixels, uint8_t *data)
+{
+    uint32_t    run = 0;
+    uint32_t    color = 0;
+    uint32_t    bits;
+    int         len = 0;
+
+    for ( int w = 0; w < VIDEO_ACTIVE_WORDS; w++ )
+    {
+        bits = pixels[w] >> 16;
+
+        if ( bits == (color ? 0xffff : 0) )
+        {
+            run += 16;
+            continue;
+        }
+
+        for ( int b = 15; b >= 0; b-- )
+        {
+            if ( ((bits >> b) & 1) != color )
+            {
+                for ( ; run >= 0x80; run >>= 7 )
+                    data[len++] = (run & 0x7f) | 0x80;
+                data[len++] = run;
+
+                color ^= 1;
+                run = 0;
+            }
+
+            run++;
+        }
+    }
+
+    for ( ; run >= 0x80; run >>= 7 )
+        data[len++] = (run & 0x7f) | 0x80;
+    data[len++] = run;
+
+    return len;
+}
@@ -0,0 +1,57 @@
+/* audio.h
+ *
+ * PWM audio sample playback and voice mixer
+ *
+ */
+
+#ifndef     __AUDIO_H__
+#define     __AUDIO_H__
+
+#include    <stdint.h>
+
+#include    "io.h"
+
+/* ----------------------------------------------------------------------------
+ * Module definitions
+ */
+#define     AUDIO_VOICES            4
+
+/* Sample blocks are a power of 2 so that the DMA read ring
+ * wraps the read address back to the start of the block.
+ * A block must play for a little longer than one mixer call period,
+ * so the sample rate is set to play a block in ~1.05 game ticks.
+ */
+#define     AUDIO_BLOCK_BITS        10
+#define     AUDIO_BLOCK_LEN         (1 << AUDIO_BLOCK_BITS)
+#define     AUDIO_SAMPLE_RATE       ((AUDIO_BLOCK_LEN * TIME_1SEC * 19) / 20)
+
+#define     AUDIO_PWM_WRAP          255     // 8-bit samples, ~586KHz PWM carrier
+#define     AUDIO_SILENCE           ((AUDIO_PWM_WRAP + 1) / 2)
+
+typedef enum
+{
+    AUDIO_SQUARE,
+    AUDIO_NOISE,
+    AUDIO_WAVETABLE
+} audio_wave_t;
+
+typedef struct
+{
+    uint8_t     attack;     // Mixer calls (ticks) from 0 to peak volume
+    uint8_t     decay;      // Ticks from peak to sustain level
+    uint8_t     sustain;    // Sustain level 0..255 (fraction of peak volume)
+    uint8_t     release;    // Ticks from sustain to 0 after audio_voice_off()
+} audio_envelope_t;
+
+/* Module functions
+ */
+void        audio_init(void);
+void        audio_mix(void);
+
+void        audio_voice_on(int voice, audio_wave_t wave, uint32_t freq, uint8_t volume, const audio_envelope_t *envelope);
+void        audio_voice_off(int voice);
+void        audio_voice_set_freq(int voice, uint32_t freq);
+void        audio_voice_set_table(int voice, const int8_t *table);
+int         audio_voice_is_active(int voice);
+
+#endif  /* __AUDIO_H__ */
@@ -0,0 +1,36 @@
+/* bricks.h
+ *
+ *  Brick wall occupancy and collision
+ *
+ */
+
+#ifndef     __BRICKS_H__
+#define     __BRICKS_H__
+
+#include    <stdint.h>
+
+/* ----------------------------------------------------------------------------
+ * Module definitions
+ */
+#define     BRICKS_MAX_COLS         32      // One occupancy bit per column in a row word
+#define     BRICKS_MAX_ROWS         32
+
+typedef struct
+{
+    uint32_t    row[BRICKS_MAX_ROWS];       // Occupancy bits, bit 'n' is column 'n'
+    int         x0, y0;                     // Top left corner of the wall in pixels
+    int         col_shift, row_shift;       // Cell width and height as powers of two
+    int         cols, rows;
+    int         count;                      // Bricks in the wall
+} bricks_t;
+
+/* Module functions
+ */
+void        bricks_init(bricks_t *wall, int x0, int y0, int col_shift, int row_shift, int cols, int rows);
+void        bricks_fill(bricks_t *wall);
+int         bricks_test(const bricks_t *wall, int col, int row);
+void        bricks_clear(bricks_t *wall, int col, int row);
+int         bricks_count(const bricks_t *wall);
+int         bricks_collide(bricks_t *wall, int x0, int y0, int x1, int y1, int *col, int *row);
+
+#endif  /* __BRICKS_H__ */
@@ -0,0 +1,37 @@
+/* entity.h
+ *
+ * Moving object (entity) store
+ *
+ */
+
+#ifndef     __ENTITY_H__
+#define     __ENTITY_H__
+
+#include    <stdint.h>
+
+#include    "video.h"
+
+/* ----------------------------------------------------------------------------
+ * Module definitions
+ */
+#define     ENTITY_MAX              256
+#define     ENTITY_NO_SPRITE        0xff    // Entity is drawn into the frame buffer, not a scanout sprite
+#define     ENTITY_FRAC_BITS        8       // Fixed point fraction bits of position and velocity
+
+#define     ENTITY_TO_FIXED(p)      ((int32_t)(p) * (1 << ENTITY_FRAC_BITS))   // Multiply, defined for negative values
+#define     ENTITY_TO_PIXEL(p)      ((p) >> ENTITY_FRAC_BITS)
+
+/* Module functions
+ */
+void        entity_init(void);
+int         entity_add(int32_t x, int32_t y, int32_t vx, int32_t vy, const bit_blit_t *image, uint8_t sprite);
+void        entity_remove(int entity);
+int         entity_count(void);
+void        entity_get_pos(int entity, int *x, int *y);
+void        entity_set_pos(int entity, int32_t x, int32_t y);
+void        entity_get_vel(int entity, int32_t *vx, int32_t *vy);
+void        entity_set_vel(int entity, int32_t vx, int32_t vy);
+void        entity_update(int x_min, int y_min, int x_max, int y_max);
+int         entity_draw(void);
+
+#endif  /* __ENTITY_H__ */
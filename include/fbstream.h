@@ -0,0 +1,39 @@
+/* fbstream.h
+ *
+ * Frame buffer streaming over the stdio UART
+ *
+ */
+
+#ifndef     __FBSTREAM_H__
+#define     __FBSTREAM_H__
+
+#include    <stdint.h>
+
+/* Build the frame buffer stream
+ */
+#ifndef FBSTREAM
+#define FBSTREAM        0
+#endif
+
+/* ----------------------------------------------------------------------------
+ * Module definitions
+ */
+#define     FBSTREAM_FRAME          'F'     // Frame start: u32 tick, u16 width, u16 height
+#define     FBSTREAM_LINE           'L'     // Changed line: u16 row, run length encoded pixels
+#define     FBSTREAM_BANDWIDTH      75      // Percent of the UART bandwidth for the stream
+
+typedef struct
+{
+    uint32_t    frames;         // Frames (ticks) streamed
+    uint32_t    bytes;          // Bytes queued for transmit
+    uint32_t    max_frame_bytes;
+    uint32_t    rows_pending;   // Changed lines waiting for UART bandwidth
+} fbstream_stats_t;
+
+/* Module functions
+ */
+void        fbstream_init(void);
+void        fbstream(void);
+void        fbstream_get_stats(fbstream_stats_t *stats);
+
+#endif  /* __FBSTREAM_H__ */
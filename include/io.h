@@ -9,6 +9,8 @@
 
 #include    <stdint.h>
 
+#include    "video.h"
+
 /* ----------------------------------------------------------------------------
  * Module definitions
  */
@@ -23,20 +25,47 @@
 #define     CLOCK_GPIN0                 20
 
 #define     DMA_CHAN_NUM                0
+#define     AUDIO_DMA_CHAN_A            1
+#define     AUDIO_DMA_CHAN_B            2
+#define     AUDIO_DMA_TIMER             0
+#define     FILL_DMA_CHAN               3
+#define     FILL_DMA_CTRL_CHAN          4
+#define     SERIAL_DMA_CHAN             5
+#define     SERIAL_DMA_IRQ              DMA_IRQ_2
 
-/* Timing conatants for 30Hz frame rate
+/* Game tick rate, one tick per video field (vertical retrace),
+ * 60Hz NTSC or 50Hz PAL. All timing constants are derived from it.
  */
-#define     TIME_100MSEC                3
-#define     TIME_1SEC                   30
-#define     TIME_10SEC                  300
+#define     TICK_RATE                   VIDEO_FIELD_RATE
+
+#define     TIME_100MSEC                (TICK_RATE / 10)
+#define     TIME_1SEC                   TICK_RATE
+#define     TIME_10SEC                  (10 * TICK_RATE)
+
+typedef void (*io_callback_t)(void);
+
+typedef struct
+{
+    uint32_t    total_cycles;   // Cycles in the measurement period
+    uint32_t    idle_cycles;    // Cycles sleeping in io_wait_vsync(), less scan line interrupts taken while asleep
+    uint32_t    isr_cycles;     // Cycles in the scan line interrupt handler
+} io_load_t;
 
 /* Module functions
  */
 void        io_init(void);
 uint16_t    io_adc_read(void);
-void        io_sound_on(uint16_t pitch);
-void        io_sound_off(void);
 void        io_timing_pin(int state);
 int         io_is_vert_retrace(void);
+int         io_is_odd_field(void);
+void        io_wait_vsync(void);
+uint32_t    io_get_cycles(void);
+uint32_t    io_get_vsync_cycles(void);
+uint32_t    io_get_vblank_cycles(void);
+uint32_t    io_get_line_cycles(void);
+void        io_get_load(io_load_t *load);
+uint32_t    io_get_tick_count(void);
+void        io_dma_fill(uint32_t * const *line_table, uint32_t word_count, uint32_t value, io_callback_t callback);
+int         io_dma_fill_busy(void);
 
 #endif  /* __IO_H__ */
\ No newline at end of file
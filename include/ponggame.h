@@ -9,7 +9,14 @@
 
 #include    <stdint.h>
 
+/* Build the breakout mode, with bricks that the ball removes
+ */
+#ifndef BREAKOUT_MODE
+#define BREAKOUT_MODE   0
+#endif
+
 void    ponggame(void);
 void    ponggame_init(void);
+void    ponggame_render(void);
 
 #endif /* __PONGGAME_H__ */
\ No newline at end of file
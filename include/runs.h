@@ -0,0 +1,34 @@
+/* runs.h
+ *
+ * Sparse frame buffer rows of white pixel runs
+ *
+ */
+
+#ifndef     __RUNS_H__
+#define     __RUNS_H__
+
+#include    <stdint.h>
+
+#include    "video.h"
+
+/* ----------------------------------------------------------------------------
+ * Module definitions
+ */
+typedef struct
+{
+    uint32_t    used;           // Runs in the rows
+    uint32_t    max_used;       // Most runs in the rows
+    uint32_t    drops;          // Spans not drawn, or drawn in part, because the pool was empty
+} runs_stats_t;
+
+/* Module functions
+ */
+void        runs_init(void);
+int         runs_span(uint32_t row, uint32_t x0, uint32_t x1, pixel_action_t action);
+void        runs_clear_row(uint32_t row);
+void        runs_clear(void);
+int         runs_row_used(uint32_t row);
+void        runs_expand(uint32_t row, uint32_t *line);
+void        runs_get_stats(runs_stats_t *stats);
+
+#endif  /* __RUNS_H__ */
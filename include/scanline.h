@@ -2,6 +2,10 @@
  *
  * Video scan line and sync
  *
+ * Scan line timing is given in nSec for the selected video standard,
+ * and converted to HSTX bit shifts for the HSTX clock. The sync scan line
+ * tables are generated from these parameters by scanline_init().
+ *
  */
 
 #ifndef     __SCANLINE_H__
@@ -9,258 +13,148 @@
 
 #include    <stdint.h>
 
-#define     ACTIVE_VIDEO_OFFSET     9
-#define     SCAN_LINE_BUF_LEN       48
-#define     HALF_SCAN_LINE_BUF_LEN  (SCAN_LINE_BUF_LEN-20)
-
-#define     VIDEO_X_RESOLUTION          576     // reduced by overscan out of 640
-#define     VIDEO_Y_RESOLUTION          432     // reduced by overscan out of 480
-
+#include    "video.h"
 
-
-/* Globals 
+/* ----------------------------------------------------------------------------
+ * Module definitions
  */
-static uint32_t vid_blank_scan_line[SCAN_LINE_BUF_LEN] =
-{
-/*
- *    |---- Pixel ---||---- Sync ----|
- */  
-    0b00000000000000000000000000000000,     // 10.9uSec w/ 4.7uSec SYNC
-    0b00000000000000001111111111111111,
-    0b00000000000000001111111111111111,
-    0b00000000000000001111111111111111,
-    0b00000000000000001111111100000000,
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-
-    0b00000000000000000000000000000000,     // 53.5uSec scan line
-    0b00000000000000000000000000000000,     // <- first active pixels start here
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,     // <- last active pixels end here
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-};
-
-static uint32_t vid_blank_half_scan_line[HALF_SCAN_LINE_BUF_LEN] =
-{
-/*
- *    |---- Pixel ---||---- Sync ----|
- */  
-    0b00000000000000000000000000000000,
-    0b00000000000000001111111111111111,
-    0b00000000000000001111111111111111,
-    0b00000000000000001111111111111111,
-    0b00000000000000001111111100000000,
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-};
-
-static uint32_t vid_equalizing_pulse[(SCAN_LINE_BUF_LEN+24)] =
-{
-/*
- *    |---- Pixel ---||---- Sync ----|
- */  
-    0b00000000000000000000000000000000,
-    0b00000000000000001111111111111111,
-    0b00000000000000001111111111111111,
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-
-    0b00000000000000000000000000000000,
-    0b00000000000000001111111111111111,
-    0b00000000000000001111111111111111,
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-
-    0b00000000000000000000000000000000,     // <- Extension for odd fields.
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-};
-
-static uint32_t vid_vert_sync[SCAN_LINE_BUF_LEN] =
+#define     VID_HSTX_PLL_HZ         48000000    // USB PLL, divided to the HSTX clock through GPOUT0/GPIN0
+#if (VIDEO_RESOLUTION == VIDEO_LOW_RES)
+#define     VID_HSTX_CLOCK_DIV      (2 * VIDEO_HSTX_CLOCK_DIV)  // Double width pixels
+#else
+#define     VID_HSTX_CLOCK_DIV      VIDEO_HSTX_CLOCK_DIV
+#endif
+#define     VID_HSTX_CLOCK_HZ       (VID_HSTX_PLL_HZ / VID_HSTX_CLOCK_DIV)
+#define     VID_WORD_BITS           16          // Bit shifts per 32bit word, pixel (high) and sync (low) 16 bit fields
+
+#define     VID_NS_TO_BITS(ns)      ((int)(((ns) * (VID_HSTX_CLOCK_HZ / 1000LL) + 500000) / 1000000))
+#define     VID_BITS_TO_NS(bits)    ((int)(((bits) * 1000000LL) / (VID_HSTX_CLOCK_HZ / 1000)))
+#define     VID_NS_TO_WORDS(ns)     ((VID_NS_TO_BITS(ns) + (VID_WORD_BITS / 2)) / VID_WORD_BITS)
+
+/* Video standard timing, in nSec and scan lines.
+ * Scan lines are counted per field. Equalizing and serration (vertical sync)
+ * pulses are two per scan line, so each group is a whole number of lines.
+ */
+#if (VIDEO_STANDARD == VIDEO_PAL)
+#define     VID_LINE_NS             64000       // Spec line period
+#define     VID_FRONT_PORCH_NS      1650
+#define     VID_SYNC_NS             4700
+#define     VID_EQ_PULSE_NS         2350
+#define     VID_BROAD_PULSE_NS      27300       // Serration pulse is the rest of the half line
+#define     VID_ACTIVE_START_NS     12000       // Sync + back porch + overscan
+#define     VID_ACTIVE_NS           48000       // Reduced by overscan out of 52uSec
+#define     VID_SHORT_LINE_NS       32000       // Last scan line of an odd field
+
+#define     VID_LINES_PER_FIELD     312         // 312 and 1/2 interlaced
+#define     VID_EQ_LINES            3           // 5 pulses in spec, rounded up to whole lines
+#define     VID_VSYNC_LINES         3
+#define     VID_FIRST_ACTIVE_LINE   60          // Centers 216 of 288 visible lines
+#else
+#define     VID_LINE_NS             63556
+#define     VID_FRONT_PORCH_NS      1300        // Sync starts on the first word boundary
+#define     VID_SYNC_NS             4700
+#define     VID_EQ_PULSE_NS         2700
+#define     VID_BROAD_PULSE_NS      27600
+#define     VID_ACTIVE_START_NS     12000
+#define     VID_ACTIVE_NS           48000       // Reduced by overscan out of 53.5uSec
+#define     VID_SHORT_LINE_NS       37333
+
+#define     VID_LINES_PER_FIELD     262         // 262 and 1/2 interlaced
+#define     VID_EQ_LINES            3
+#define     VID_VSYNC_LINES         3
+#define     VID_FIRST_ACTIVE_LINE   30
+#endif
+
+#define     VID_ACTIVE_LINES        216         // Active scan lines per field, reduced by overscan out of 240
+
+/* Scan line layout in HSTX bit shifts and 32bit words
+ */
+#define     VID_FRONT_PORCH_BITS    VID_NS_TO_BITS(VID_FRONT_PORCH_NS)
+#define     VID_SYNC_BITS           VID_NS_TO_BITS(VID_SYNC_NS)
+#define     VID_EQ_PULSE_BITS       VID_NS_TO_BITS(VID_EQ_PULSE_NS)
+#define     VID_BROAD_PULSE_BITS    VID_NS_TO_BITS(VID_BROAD_PULSE_NS)
+
+#define     SCAN_LINE_BUF_LEN       VID_NS_TO_WORDS(VID_LINE_NS)
+#define     HALF_LINE_WORDS         (SCAN_LINE_BUF_LEN / 2)
+#define     HALF_SCAN_LINE_BUF_LEN  VID_NS_TO_WORDS(VID_SHORT_LINE_NS)
+#define     EQ_PULSE_BUF_LEN        (SCAN_LINE_BUF_LEN + HALF_LINE_WORDS)   // Extended by half a line in an even field
+#define     ACTIVE_VIDEO_OFFSET     VID_NS_TO_WORDS(VID_ACTIVE_START_NS)
+#define     VIDEO_ACTIVE_WORDS      VID_NS_TO_WORDS(VID_ACTIVE_NS)
+
+#define     VIDEO_X_RESOLUTION      (VIDEO_ACTIVE_WORDS * VID_WORD_BITS)
+#if (VIDEO_SCAN_MODE == VIDEO_PROGRESSIVE || VIDEO_RESOLUTION == VIDEO_LOW_RES)
+#define     VIDEO_Y_RESOLUTION      VID_ACTIVE_LINES
+#define     VIDEO_ROW_STEP          1           // Frame buffer rows advanced per scan line,
+                                                // interlaced low res scans every row in both fields
+#else
+#define     VIDEO_Y_RESOLUTION      (2 * VID_ACTIVE_LINES)
+#define     VIDEO_ROW_STEP          2
+#endif
+
+/* HSTX command expander commands, in the low 16 bits of a FIFO word
+ */
+#define     VID_CMD_RAW             (0x0u << 12)    // The next 'count' words are sent as they are
+#define     VID_CMD_RAW_REPEAT      (0x1u << 12)    // The next word is sent 'count' times
+#define     VID_CMD_COUNT_MAX       0x0fff
+#define     VID_CMD_POOL_LEN        96              // Sync line command lists, all lines
+
+/* With the expander, a scan line is sent from its second word, and its
+ * blank first word is sent last with the blank words at the end of the line.
+ * Every line is rotated the same way, so the video signal is unchanged.
+ * An active line has a RAW command in its first word, and a RAW_REPEAT
+ * of a blank word in two of its blank last words.
+ */
+#define     VID_TRAILING_WORDS      (SCAN_LINE_BUF_LEN - ACTIVE_VIDEO_OFFSET - VIDEO_ACTIVE_WORDS)
+#if (VIDEO_HSTX_EXPAND == 1)
+#define     VID_ACTIVE_LINE_WORDS   (SCAN_LINE_BUF_LEN - VID_TRAILING_WORDS + 2)    // Words sent for an active line
+#else
+#define     VID_ACTIVE_LINE_WORDS   SCAN_LINE_BUF_LEN
+#endif
+
+/* Timing checks
+ */
+_Static_assert(VID_BITS_TO_NS(SCAN_LINE_BUF_LEN * VID_WORD_BITS) >= (VID_LINE_NS - VID_LINE_NS / 100) &&
+               VID_BITS_TO_NS(SCAN_LINE_BUF_LEN * VID_WORD_BITS) <= (VID_LINE_NS + VID_LINE_NS / 100),
+               "Scan line period is more than 1% off the video standard, change the HSTX clock");
+_Static_assert(VID_FRONT_PORCH_BITS + VID_SYNC_BITS <= ACTIVE_VIDEO_OFFSET * VID_WORD_BITS,
+               "Active video starts before the end of horizontal sync");
+_Static_assert(ACTIVE_VIDEO_OFFSET + VIDEO_ACTIVE_WORDS <= SCAN_LINE_BUF_LEN,
+               "Active video extends past the end of the scan line");
+_Static_assert(VID_FRONT_PORCH_BITS + VID_BROAD_PULSE_BITS < HALF_LINE_WORDS * VID_WORD_BITS,
+               "Vertical sync broad pulse does not leave a serration gap");
+_Static_assert(VID_FIRST_ACTIVE_LINE + VID_ACTIVE_LINES < VID_LINES_PER_FIELD,
+               "Active scan lines do not fit in a field");
+#if (VIDEO_HSTX_EXPAND == 1)
+_Static_assert(VID_FRONT_PORCH_BITS >= VID_WORD_BITS && VID_TRAILING_WORDS >= 2,
+               "Scan line has no blank words for the HSTX expander commands, build with VIDEO_HSTX_EXPAND=0");
+#endif
+
+/* Words sent to the HSTX FIFO for a sync or blank scan line,
+ * expander commands or a whole table
+ */
+typedef struct
 {
-/*
- *    |---- Pixel ---||---- Sync ----|
- */  
-    0b00000000000000000000000000000000,     // 10.9uSec w/ 4.7uSec SYNC
-    0b00000000000000001111111111111111,
-    0b00000000000000001111111111111111,
-    0b00000000000000001111111111111111,
-    0b00000000000000001111111111111111,
-    0b00000000000000001111111111111111,
-    0b00000000000000001111111111111111,
-    0b00000000000000001111111111111111,
-    0b00000000000000001111111111111111,
-    0b00000000000000001111111111111111,
-
-    0b00000000000000001111111111111111,
-    0b00000000000000001111111111111111,
-    0b00000000000000001111111111111111,
-    0b00000000000000001111111111111111,
-    0b00000000000000001111111111111111,
-    0b00000000000000001111111111111111,
-    0b00000000000000001111111111111111,
-    0b00000000000000001111111111111111,
-    0b00000000000000001111111111111111,
-    0b00000000000000001111111111111111,
-
-    0b00000000000000001111111111111111,
-    0b00000000000000001111111111100000,
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
+    const uint32_t *words;
+    uint32_t        count;
+} vid_line_t;
 
-    0b00000000000000000000000000000000,
-    0b00000000000000001111111111111111,
-    0b00000000000000001111111111111111,
-    0b00000000000000001111111111111111,
-    0b00000000000000001111111111111111,
-    0b00000000000000001111111111111111,
-    0b00000000000000001111111111111111,
-    0b00000000000000001111111111111111,
-    0b00000000000000001111111111111111,
-    0b00000000000000001111111111111111,
-
-    0b00000000000000001111111111111111,
-    0b00000000000000001111111111111111,
-    0b00000000000000001111111111111111,
-    0b00000000000000001111111111111111,
-    0b00000000000000001111111111111111,
-    0b00000000000000001111111111111111,
-    0b00000000000000001111111111111111,
-    0b00000000000000001111111111111111,
-    0b00000000000000001111111111111111,
-    0b00000000000000001111111111111111,
-
-    0b00000000000000001111111111111111,
-    0b00000000000000001111111111100000,
-    0b00000000000000000000000000000000,
-    0b00000000000000000000000000000000,
-};
+/* Globals
+ */
+extern uint32_t vid_blank_scan_line[SCAN_LINE_BUF_LEN];
+extern uint32_t vid_blank_half_scan_line[HALF_SCAN_LINE_BUF_LEN];
+extern uint32_t vid_equalizing_pulse[EQ_PULSE_BUF_LEN];
+extern uint32_t vid_vert_sync[SCAN_LINE_BUF_LEN];
+
+extern vid_line_t   vid_blank_line;
+extern vid_line_t   vid_blank_half_line;
+extern vid_line_t   vid_equalizing_line;
+extern vid_line_t   vid_equalizing_long_line;   // Extended by half a line in an even field
+extern vid_line_t   vid_vert_sync_line;
+extern vid_line_t   vid_blank_word_line;       // One blank word, the last line of an even field
+
+/* Module functions
+ */
+void        scanline_init(void);
+void        scanline_active_init(uint32_t *line);
 
-#endif  /* __SCANLINE_H__ */
\ No newline at end of file
+#endif  /* __SCANLINE_H__ */
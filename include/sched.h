@@ -0,0 +1,51 @@
+/* sched.h
+ *
+ * Vertical blanking task scheduler
+ *
+ */
+
+#ifndef     __SCHED_H__
+#define     __SCHED_H__
+
+#include    <stdint.h>
+
+/* ----------------------------------------------------------------------------
+ * Module definitions
+ */
+#define     SCHED_TASKS_MAX         10
+
+#define     SCHED_PRIO_CRITICAL     255     // Runs every time it is due, even if the window is closed
+#define     SCHED_PRIO_HIGH         128
+#define     SCHED_PRIO_LOW          64      // Deferred if its budget does not fit in the window
+#define     SCHED_PRIO_BACKGROUND   0       // Runs after the blanking window, before the next field
+
+typedef void (*sched_func_t)(void);
+
+typedef struct
+{
+    const char     *name;
+    sched_func_t    func;
+    uint8_t         priority;   // Higher priority tasks run first
+    uint16_t        period;     // Ticks between runs, 0 or 1 to run every tick
+    uint16_t        budget_us;  // Worst case run time
+
+    /* Maintained by the scheduler
+     */
+    uint8_t         id;         // Order in which the task was added
+    uint32_t        budget;     // Run time budget in CPU cycles
+    uint32_t        due;        // Tick count at which the task is next due
+    uint32_t        runs;
+    uint32_t        deferrals;  // Due but did not fit in the remaining window
+    uint32_t        overruns;   // Ran longer than its budget
+    uint32_t        misses;     // Completed after its window closed
+    uint32_t        max_cycles;
+} sched_task_t;
+
+/* Module functions
+ */
+void        sched_init(void);
+int         sched_add(sched_task_t *task);
+void        sched_run(void);
+void        sched_print_stats(void);
+
+#endif  /* __SCHED_H__ */
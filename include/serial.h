@@ -0,0 +1,38 @@
+/* serial.h
+ *
+ * Non-blocking UART transmit queue
+ *
+ */
+
+#ifndef     __SERIAL_H__
+#define     __SERIAL_H__
+
+#include    <stdint.h>
+
+/* ----------------------------------------------------------------------------
+ * Module definitions
+ */
+#define     SERIAL_TX_BUF_SIZE      8192        // Bytes, power of 2
+
+#define     SERIAL_PACKET_SYNC      0xa5        // Packet start, not a text (ASCII) byte
+#define     SERIAL_PACKET_HEADER    4           // Sync, type and 16 bit payload length
+#define     SERIAL_PACKET_MAX       2048        // Largest payload
+
+typedef struct
+{
+    uint32_t    bytes;          // Bytes queued for transmit
+    uint32_t    drops;          // Writes dropped because the queue was full
+    uint32_t    lines_dropped;  // stdio lines dropped, in part or whole
+    uint32_t    max_used;       // Most bytes waiting in the queue
+} serial_stats_t;
+
+/* Module functions
+ */
+void        serial_init(void);
+int         serial_write(const void *data, uint32_t len);
+int         serial_write_packet(uint8_t type, const void *payload, uint32_t len);
+uint32_t    serial_free(void);
+uint32_t    serial_bytes_per_tick(void);
+void        serial_get_stats(serial_stats_t *stats);
+
+#endif  /* __SERIAL_H__ */
@@ -0,0 +1,45 @@
+/* sfx.h
+ *
+ * Tick timed sound effect sequencer
+ *
+ */
+
+#ifndef     __SFX_H__
+#define     __SFX_H__
+
+#include    <stdint.h>
+
+#include    "audio.h"
+
+/* ----------------------------------------------------------------------------
+ * Module definitions
+ */
+#define     SFX_CHANNELS            AUDIO_VOICES    // One mixer voice per playing effect
+#define     SFX_REST                0               // Note frequency for a silent note
+
+typedef struct
+{
+    uint16_t    freq;       // Start frequency in Hz, or SFX_REST
+    int16_t     sweep;      // Frequency change in Hz per tick
+    uint16_t    ticks;      // Note duration in game ticks
+} sfx_note_t;
+
+typedef struct
+{
+    const sfx_note_t       *notes;
+    uint8_t                 note_count;
+    uint8_t                 priority;   // Higher priority effects steal voices from lower ones
+    uint8_t                 volume;
+    audio_wave_t            wave;
+    const audio_envelope_t *envelope;   // Restarted on every note, NULL for none
+} sfx_t;
+
+/* Module functions
+ */
+void        sfx_init(void);
+void        sfx_tick(void);
+int         sfx_play(const sfx_t *effect);
+void        sfx_stop(const sfx_t *effect);
+int         sfx_is_playing(const sfx_t *effect);
+
+#endif  /* __SFX_H__ */
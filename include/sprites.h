@@ -2,133 +2,24 @@
  *
  *  Game bitmap sprites
  *
+ *  The sprite tables are generated at build time from the images
+ *  in assets/ by tools/img2sprite.py, this header adds the
+ *  game's placement details for them.
+ *
  */
 
 #ifndef     __SPRITES_H__
 #define     __SPRITES_H__
 
-#include    <stdint.h>
-
-#define     SPRITE_NUMBERS_COLS     8
-#define     SPRITE_NUMBERS_ROWS     12
-
-uint8_t sprite_numbers[(10 * SPRITE_NUMBERS_ROWS)] =
-{
-    0x38, 0x44, 0x82, 0x82, 0x82, 0x82, 0x82, 0x82, 0x82, 0x82, 0x44, 0x38, // '0'
-    0x02, 0x06, 0x0a, 0x12, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, // '1'
-    0x38, 0x44, 0x82, 0x02, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80, 0xfe, // '2'
-    0x38, 0x44, 0x82, 0x02, 0x04, 0x38, 0x04, 0x02, 0x02, 0x82, 0x44, 0x38, // '3'
-    0x04, 0x84, 0x84, 0x84, 0x84, 0x84, 0xfe, 0x04, 0x04, 0x04, 0x04, 0x04, // '4'
-    0xfe, 0x80, 0x80, 0x80, 0x80, 0x7c, 0x02, 0x02, 0x02, 0x82, 0x44, 0x38, // '5'
-    0x3c, 0x42, 0x80, 0x80, 0x80, 0x80, 0x7c, 0x82, 0x82, 0x82, 0x82, 0x7c, // '6'
-    0xfe, 0x02, 0x02, 0x04, 0x04, 0x08, 0x08, 0x10, 0x10, 0x20, 0x20, 0x40, // '7'
-    0x38, 0x44, 0x82, 0x82, 0x44, 0x38, 0x44, 0x82, 0x82, 0x82, 0x44, 0x38, // '8'
-    0x38, 0x44, 0x82, 0x82, 0x82, 0x82, 0x7c, 0x02, 0x02, 0x02, 0x82, 0x7c, // '9'
-};
-
-#define     SPRITE_BALL_COLS        15
-#define     SPRITE_BALL_ROWS        15
+#include    "assets.h"
 
-uint8_t sprite_ball[(2 * SPRITE_BALL_ROWS)] =
-{
-    0b00000111, 0b11000000,
-    0b00011010, 0b00110000,
-    0b00100010, 0b00001000,
-    0b01000010, 0b00000100,
-    0b01000010, 0b00000100,
-    0b10000110, 0b00000010,
-    0b10001100, 0b00001110,
-    0b10111000, 0b00111010,
-    0b11100000, 0b11000010,
-    0b10000000, 0b10000010,
-    0b01000001, 0b10000100,
-    0b01000001, 0b00000100,
-    0b00100001, 0b00001000,
-    0b00011001, 0b00110000,
-    0b00000111, 0b11000000,
-};
-
-#define     SPRITE_PADDLE_COLS      11
-#define     SPRITE_PADDLE_ROWS      32
 #define     SPRITE_PADDLE_LENGTH    24  // Pixels from top
 #define     SPRITE_PADDLE_CENTER    5   // Pixels from left
 
-uint8_t sprite_paddle[(2 * SPRITE_PADDLE_ROWS)] =
-{
-    0b00001110, 0b00000000,
-    0b00010101, 0b00000000,
-    0b00100000, 0b10000000,
-    0b00101010, 0b10000000,
-    0b01000000, 0b01000000,
-    0b01010101, 0b01000000,
-    0b01000000, 0b01000000,
-    0b01001010, 0b01000000,
-    0b10000000, 0b00100000,
-    0b10010101, 0b00100000,
-    0b10000000, 0b00100000,
-    0b10101010, 0b10100000,
-    0b10000000, 0b00100000,     // <-- paddle center [12 pixels]
-    0b10010101, 0b00100000,
-    0b10000000, 0b00100000,
-    0b10101010, 0b10100000,
-    0b10000000, 0b00100000,
-    0b10010101, 0b00100000,
-    0b10000000, 0b00100000,
-    0b01001010, 0b01000000,
-    0b01000000, 0b01000000,
-    0b01010101, 0b01000000,
-    0b01000000, 0b01000000,
-    0b00101010, 0b10000000,
-    0b00100000, 0b10000000,
-    0b00010101, 0b00000000,
-    0b00001110, 0b00000000,
-    0b00001110, 0b00000000,
-    0b00001110, 0b00000000,
-    0b00001010, 0b00000000,
-    0b00010001, 0b00000000,
-    0b00001110, 0b00000000,
-};
-
-#define     SPRITE_BRICK_COLS       16
-#define     SPRITE_BRICK_ROWS       32
-
-#define     SPRITE_HALF_BRICK_COLS  16
+#define     SPRITE_HALF_BRICK_COLS  SPRITE_BRICK_COLS
 #define     SPRITE_HALF_BRICK_ROWS  (SPRITE_BRICK_ROWS / 2)
 
-uint8_t sprite_brick[(2 * SPRITE_BRICK_ROWS)] =
-{
-    0b00000000, 0b00000000,
-    0b00011111, 0b11111000,
-    0b00110000, 0b00001100,
-    0b01100000, 0b00000110,
-    0b01000000, 0b00000010,
-    0b01001000, 0b00010010,
-    0b01001000, 0b00010010,
-    0b01001001, 0b00010010,
-    0b01001001, 0b00010010,
-    0b01001001, 0b00010010,
-    0b01001001, 0b00000010,
-    0b01000001, 0b00000010,
-    0b01000000, 0b00000010,
-    0b01001000, 0b00010010,
-    0b01001000, 0b10010010,
-    0b01001000, 0b10010010,
-    0b01001000, 0b10010010,
-    0b01001000, 0b10010010,
-    0b01000000, 0b10010010,
-    0b01000000, 0b10010010,
-    0b01000000, 0b10000010,
-    0b01001000, 0b00000010,
-    0b01001000, 0b00010010,
-    0b01001001, 0b00010010,
-    0b01001001, 0b00010010,
-    0b01000001, 0b00010010,
-    0b01000001, 0b00000010,
-    0b01000001, 0b00000010,
-    0b01100000, 0b00000110,
-    0b00110000, 0b00001100,
-    0b00011111, 0b11111000,
-    0b00000000, 0b00000000,
-};
+#define     TILE_HALF_BRICK_ROWS    (TILE_BRICK_ROWS / 2)
+#define     TILE_LOWER_HALF_BRICK   (TILE_BRICK + (TILE_BRICK_COLS * TILE_HALF_BRICK_ROWS))
 
 #endif  /* __SPRITES_H__ */
@@ -0,0 +1,23 @@
+/* stress.h
+ *
+ *  Many ball stress mode definitions
+ *
+ */
+
+#ifndef __STRESS_H__
+#define __STRESS_H__
+
+#include    <stdint.h>
+
+/* Build the stress mode instead of the game
+ */
+#ifndef STRESS_MODE
+#define STRESS_MODE     0
+#endif
+
+void    stress(void);
+void    stress_init(void);
+void    stress_render(void);
+void    stress_step(void);
+
+#endif /* __STRESS_H__ */
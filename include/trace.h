@@ -0,0 +1,72 @@
+/* trace.h
+ *
+ * Binary event trace
+ *
+ */
+
+#ifndef     __TRACE_H__
+#define     __TRACE_H__
+
+#include    <stdint.h>
+
+/* Build the event trace
+ */
+#ifndef TRACE
+#define TRACE           0
+#endif
+
+/* ----------------------------------------------------------------------------
+ * Module definitions
+ */
+#define     TRACE_RECORDS           256     // Ring size in records, power of 2
+#define     TRACE_PACKET            'T'     // Trace records
+#define     TRACE_NAME_PACKET       'N'     // Task name: u8 task, name text
+
+/* Event IDs, the meaning of 'arg' and 'value'
+ */
+typedef enum
+{
+    TRACE_FRAME = 1,        // Tick's tasks done: value is cycles from vertical retrace
+    TRACE_TASK,             // Task ran: arg is the task index, value is its cycles
+    TRACE_ISR,              // Field's scan line interrupts: value is the longest in cycles
+    TRACE_BOUNCE,           // Ball bounced: arg is a trace_bounce_t, value is y << 16 | x
+    TRACE_SCORE,            // Score changed: value is the new score
+    TRACE_DROPS,            // Records dropped because the ring was full: value is the total
+} trace_id_t;
+
+typedef enum
+{
+    TRACE_BOUNCE_PADDLE = 0,
+    TRACE_BOUNCE_WALL,
+    TRACE_BOUNCE_EDGE,      // Top or bottom of the board
+    TRACE_BOUNCE_BRICK,
+} trace_bounce_t;
+
+typedef struct
+{
+    uint32_t    cycles;     // CPU cycle counter when recorded
+    uint32_t    value;
+    uint16_t    seq;        // Record sequence number, low 16 bits
+    uint8_t     id;
+    uint8_t     arg;
+} trace_record_t;
+
+_Static_assert(sizeof(trace_record_t) == 12, "trace record is sent as 12 bytes");
+
+/* Record an event, compiled out when the trace is not built
+ */
+#if (TRACE == 1)
+#define     TRACE_EVENT(id, arg, value)     trace_record((id), (arg), (value))
+#else
+#define     TRACE_EVENT(id, arg, value)
+#endif
+
+/* Module functions
+ */
+void        trace_init(void);
+void        trace_record(trace_id_t id, uint8_t arg, uint32_t value);
+void        trace_name(uint8_t arg, const char *name);
+void        trace_drain(void);
+uint32_t    trace_get_drops(void);
+
+#endif  /* __TRACE_H__ */
@@ -9,6 +9,95 @@
 
 #include    <stdint.h>
 
+/* Video scan modes, select with VIDEO_SCAN_MODE at build time
+ */
+#define     VIDEO_INTERLACED        0       // 525 line interlaced (480i), 576x432 at 30Hz frame rate
+#define     VIDEO_PROGRESSIVE       1       // 262 line progressive (240p), 576x216 at 60Hz frame rate
+
+#ifndef     VIDEO_SCAN_MODE
+#define     VIDEO_SCAN_MODE         VIDEO_INTERLACED
+#endif
+
+/* Video resolutions, select with VIDEO_RESOLUTION at build time
+ */
+#define     VIDEO_HIGH_RES          0       // 576x432 interlaced, 576x216 progressive
+#define     VIDEO_LOW_RES           1       // 288x216, half pixel clock and each row scanned in both fields
+
+#ifndef     VIDEO_RESOLUTION
+#define     VIDEO_RESOLUTION        VIDEO_HIGH_RES
+#endif
+
+/* Video standards, select with VIDEO_STANDARD at build time
+ */
+#define     VIDEO_NTSC              0       // 525 lines, 60Hz field rate
+#define     VIDEO_PAL               1       // 625 lines, 50Hz field rate
+
+#ifndef     VIDEO_STANDARD
+#define     VIDEO_STANDARD          VIDEO_NTSC
+#endif
+
+#if (VIDEO_STANDARD == VIDEO_PAL)
+#define     VIDEO_FIELD_RATE        50
+#else
+#define     VIDEO_FIELD_RATE        60
+#endif
+
+/* HSTX (pixel) clock divider from the 48MHz USB PLL, select with VIDEO_HSTX_CLOCK_DIV
+ * at build time. Horizontal resolution scales with the pixel clock:
+ * 4 = 12MHz 576 pixels, 3 = 16MHz 768 pixels. The low resolution mode
+ * doubles the divider.
+ */
+#ifndef     VIDEO_HSTX_CLOCK_DIV
+#define     VIDEO_HSTX_CLOCK_DIV    4
+#endif
+
+/* HSTX command expander for the sync and blanking lines, select with VIDEO_HSTX_EXPAND
+ * at build time: 1 = sync lines are sent as short run length command lists,
+ * 0 = every line is sent as a whole table of words. The expander needs a blank
+ * first word and two blank last words in a scan line, which the low resolution
+ * mode does not have, so it is off there by default.
+ */
+#ifndef     VIDEO_HSTX_EXPAND
+#if (VIDEO_RESOLUTION == VIDEO_LOW_RES)
+#define     VIDEO_HSTX_EXPAND       0
+#else
+#define     VIDEO_HSTX_EXPAND       1
+#endif
+#endif
+
+/* Dynamic plane storage, select with VIDEO_RUN_PLANE at build time:
+ * 0 = a bitmap with the scan line layout, like the static plane,
+ * 1 = a list of white pixel runs per row, expanded into the line buffer at
+ * scanout. Runs are 6 bytes each from a pool of VIDEO_RUNS, so a mostly
+ * black plane takes a few KB instead of a bitmap, and clearing it costs
+ * the runs in it. Drawing that needs more runs than the pool has is dropped.
+ */
+#ifndef     VIDEO_RUN_PLANE
+#define     VIDEO_RUN_PLANE         0
+#endif
+
+#ifndef     VIDEO_RUNS
+#define     VIDEO_RUNS              1024
+#endif
+
+/* Static plane storage, select with VIDEO_TILE_MAP at build time:
+ * 0 = a bitmap with the scan line layout,
+ * 1 = a map of a tile byte per 8x8 pixel cell, 72x54 cells at 576x432,
+ * indexing a tile set of up to VIDEO_TILES tiles that is copied to RAM,
+ * expanded into the line buffer at scanout. The map takes about 4KB instead
+ * of a bitmap. Drawing functions draw into the dynamic plane, which is an
+ * overlay on the tiles.
+ */
+#ifndef     VIDEO_TILE_MAP
+#define     VIDEO_TILE_MAP          0
+#endif
+
+#ifndef     VIDEO_TILES
+#define     VIDEO_TILES             32
+#endif
+
+#define     VIDEO_TILE_SIZE         8
+
 typedef enum
 {
     CLEAR,
@@ -18,28 +107,96 @@ typedef enum
 
 typedef struct
 {
-    uint8_t    *bitmap;     // bitmap byte-array
-    uint32_t    col_count;  // in pixels, non-zerp
-    uint32_t    row_count;  // in pixels, non-zero
+    const uint8_t  *bitmap;     // bitmap byte-array
+    uint32_t        col_count;  // in pixels, non-zerp
+    uint32_t        row_count;  // in pixels, non-zero
 } bit_blit_t;
 
+/* Lines and bitmaps may be placed off screen, coordinates passed as uint32_t
+ * are taken as signed. Lines with an end further than this are not drawn,
+ * the bound keeps the line clipping products within 32 bits.
+ */
+#define     VIDEO_LINE_COORD_MAX    0x3fff
+
+/* Run length encoded 1 bit image, generated by tools/img2sprite.py.
+ * The data is alternating black and white run lengths in pixels,
+ * starting with black, each an unsigned LEB128 number (7 bits per byte,
+ * low bits first, MSB set if more bytes follow). Runs continue from
+ * the end of one image row to the start of the next.
+ */
+typedef struct
+{
+    const uint8_t  *data;       // Run lengths
+    uint32_t        size;       // Bytes of run length data
+    uint32_t        col_count;  // in pixels, non-zero
+    uint32_t        row_count;  // in pixels, non-zero
+} video_rle_t;
+
+typedef void (*video_callback_t)(void);
+
+/* Frame buffer planes, ORed at scanout
+ */
+typedef enum
+{
+    VIDEO_PLANE_STATIC,
+    VIDEO_PLANE_DYNAMIC
+} video_plane_t;
+
+#define     VIDEO_PLANES            2
+
+/* Sprites are merged over the frame buffer during scanout,
+ * lower priority sprites first.
+ */
+#define     VIDEO_SPRITES           8
+#define     VIDEO_SPRITE_MAX_COLS   32
+#define     VIDEO_SPRITE_MAX_ROWS   32
+
+typedef struct
+{
+    uint32_t    max_cycles;     // Longest scan line composition in CPU cycles
+    uint32_t    max_sprites;    // Most sprites merged on one scan line
+} video_line_stats_t;
+
 
 /* Module functions
  */
 void        video_init(void);
 
+void        video_set_plane(video_plane_t plane);
 void        video_clear_screen(int color);
+void        video_fill_rect(uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1, int color, video_callback_t callback);
+int         video_fill_busy(void);
+void        video_fill_wait(void);
 void        video_set_default_action(pixel_action_t action);
 void        video_set_pixel(uint32_t x, uint32_t y);
 void        video_line(uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1);
 void        video_box(uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1);
 void        video_circle(uint32_t x0, uint32_t y0, uint32_t r);
 void        video_flood_fill(uint32_t x0, uint32_t y0);
-void        video_bit_blit(uint32_t x0, uint32_t y0, bit_blit_t *bitmap);
+void        video_bit_blit(uint32_t x0, uint32_t y0, const bit_blit_t *bitmap);
 void        video_write_text(uint32_t x, uint32_t y, char *text);
+int         video_rle_image(uint32_t x0, uint32_t y0, const video_rle_t *image);
+
+int         video_sprite_set(int sprite, const bit_blit_t *image, const uint8_t *mask, uint8_t priority);
+void        video_sprite_move(int sprite, int x, int y);
+void        video_sprite_enable(int sprite, int enable);
+void        video_sprite_cost(uint32_t *line_cycles, uint32_t *sprite_cycles);
+void        video_get_line_stats(video_line_stats_t *stats);
+
+void        video_map_rows(uint32_t display_row, uint32_t count, uint32_t row, uint32_t repeat);
+void        video_set_row_offset(int offset);
+void        video_reset_rows(void);
+
+#if (VIDEO_TILE_MAP == 1)
+int         video_tile_set(const uint8_t *tiles, uint32_t count);
+void        video_tile_put(uint32_t col, uint32_t row, uint32_t tile);
+void        video_tile_fill(uint32_t col, uint32_t row, uint32_t cols, uint32_t rows, uint32_t tile);
+int         video_tile_block(uint32_t col, uint32_t row, uint32_t first, uint32_t cols, uint32_t rows);
+#endif
 
-uint32_t*   video_get_even_field(void);
-uint32_t*   video_get_odd_field(void);
+void        video_begin_field(void);
+uint32_t*   video_scan_line(uint32_t display_row);
+uint32_t*   video_read_line(uint32_t display_row, uint32_t *line);
 
 uint32_t    video_get_x_res(void);
 uint32_t    video_get_y_res(void);
@@ -11,27 +11,34 @@
 #include    "hardware/dma.h"
 #include    "hardware/irq.h"
 #include    "hardware/clocks.h"
-#include    "hardware/pwm.h"
+#include    "hardware/sync.h"
+#include    "hardware/structs/m33.h"
 #include    "hardware/structs/hstx_ctrl.h"
 #include    "hardware/structs/hstx_fifo.h"
  
 #include    "scanline.h"
 #include    "video.h"
+#include    "trace.h"
 #include    "io.h"
 
 /* ----------------------------------------------------------------------------
  * Module definitions
  */
-/* NTSC Interlace Scan line parameters
+/* Interlace Scan line parameters, from the video standard in scanline.h.
+ * In progressive mode every field is LINES_PER_FIELD lines with no half line,
+ * and all fields are 'odd' fields.
+ * In interlaced low resolution mode both fields start at the first display row,
+ * so every row is repeated on the two interlaced scan lines of a frame.
+ * Display rows are mapped to frame buffer rows by the row table in video.c.
  */
-#define     LINES_PER_FIELD             262         // 262 and 1/2
+#define     LINES_PER_FIELD             VID_LINES_PER_FIELD                         // NTSC 262 and 1/2 interlaced
 
-#define     PRE_EQUALIZING_PULSES       0           //   0 ... 2
-#define     VERTICAL_SYNC               3           //   3 ... 5
-#define     POST_EQUALIZING_PULSES      6           //   6 ... 8
-#define     PRE_RENDER_BLANK_SCAN_LINE  9           //   9 ... 29
-#define     FIRST_ACTIVE_SCAN_LINE      30          //  30 ... 245
-#define     POST_RENDER_BLANK_SCAN_LINE 246         // 246 ... 262
+#define     PRE_EQUALIZING_PULSES       0                                           // NTSC   0 ... 2
+#define     VERTICAL_SYNC               (PRE_EQUALIZING_PULSES + VID_EQ_LINES)      // NTSC   3 ... 5
+#define     POST_EQUALIZING_PULSES      (VERTICAL_SYNC + VID_VSYNC_LINES)           // NTSC   6 ... 8
+#define     PRE_RENDER_BLANK_SCAN_LINE  (POST_EQUALIZING_PULSES + VID_EQ_LINES)     // NTSC   9 ... 29
+#define     FIRST_ACTIVE_SCAN_LINE      VID_FIRST_ACTIVE_LINE                       // NTSC  30 ... 245
+#define     POST_RENDER_BLANK_SCAN_LINE (FIRST_ACTIVE_SCAN_LINE + VID_ACTIVE_LINES) // NTSC 246 ... 262
 
 #define     LAST_SCAN_LINE              (LINES_PER_FIELD-1)
 
@@ -48,19 +55,31 @@
 #warning "ADC averaging is out of range. Reduce ADC_AVERAGE_BITS!"
 #endif
 
-#define     PWM_DIV             250
-
 /* ----------------------------------------------------------------------------
  * Function prototypes
  */
 static void dma_irq_handler();
+static void dma_fill_irq_handler();
 
 /* ----------------------------------------------------------------------------
  * Module globals
  */
 static volatile int         in_vert_retrace = 0;
-static volatile uint32_t    frame_counter = 0;
-static int                  pwn_slice_num = -1;
+static volatile uint32_t    tick_counter = 0;
+static volatile int         is_even_field = (VIDEO_SCAN_MODE != VIDEO_PROGRESSIVE);
+static volatile int         vsync_pending = 0;
+static volatile uint32_t    isr_cycles = 0;
+#if (TRACE == 1)
+static uint32_t             isr_max_cycles = 0;     // Longest scan line interrupt in the field
+#endif
+static uint32_t             idle_cycles = 0;
+static uint32_t             load_start = 0;
+static volatile uint32_t    vsync_cycles = 0;
+static uint32_t             vblank_cycles = 0;
+static uint32_t             line_cycles = 0;
+static volatile int         fill_busy = 0;
+static uint32_t             fill_value;
+static io_callback_t        fill_callback = 0;
 
 /***************************************************************
  * io_init()
@@ -73,10 +92,17 @@ static int                  pwn_slice_num = -1;
  */
 void io_init(void)
 {
-    pwm_config pwm_configuration;
-
     stdio_init_all();
 
+    /* Cycle counter for load and timing measurements
+     */
+    m33_hw->demcr |= M33_DEMCR_TRCENA_BITS;
+    m33_hw->dwt_cyccnt = 0;
+    m33_hw->dwt_ctrl |= M33_DWT_CTRL_CYCCNTENA_BITS;
+
+    line_cycles = ((uint64_t)clock_get_hz(clk_sys) * SCAN_LINE_BUF_LEN * VID_WORD_BITS) / VID_HSTX_CLOCK_HZ;
+    vblank_cycles = line_cycles * FIRST_ACTIVE_SCAN_LINE;
+
     /* Turn off LED
      */
     gpio_init(PICO_DEFAULT_LED_PIN);
@@ -99,13 +125,6 @@ void io_init(void)
         io_adc_read();  // "Prime" the ADC input filter
     }
 
-    /* PWM
-     */
-    gpio_set_function(PWM_OUTPUT_GPIO, GPIO_FUNC_PWM);
-    pwn_slice_num = pwm_gpio_to_slice_num(PWM_OUTPUT_GPIO);
-    pwm_set_clkdiv(pwn_slice_num, PWM_DIV);
-    pwm_set_clkdiv_mode (pwn_slice_num, PWM_DIV_FREE_RUNNING);
-
     /* Initalized SYNC and PIXEL GPIOs
      */
     gpio_set_function(GPIO_SYNC, GPIO_FUNC_HSTX);
@@ -114,7 +133,7 @@ void io_init(void)
     /* HSTX clock source and divider
      */
 
-    clock_gpio_init_int_frac8(CLOCK_GPOUT0, CLOCKS_CLK_GPOUT0_CTRL_AUXSRC_VALUE_CLKSRC_PLL_USB, 4, 0);
+    clock_gpio_init_int_frac8(CLOCK_GPOUT0, CLOCKS_CLK_GPOUT0_CTRL_AUXSRC_VALUE_CLKSRC_PLL_USB, VID_HSTX_CLOCK_DIV, 0);
     clock_configure_gpin(clk_hstx, CLOCK_GPIN0, 1, 1);
 
     /* Initialize HSTX
@@ -129,11 +148,23 @@ void io_init(void)
         (31u << HSTX_CTRL_BIT1_SEL_N_LSB) |
         (HSTX_CTRL_BIT1_INV_BITS);
 
+    /* The command expander sends each raw data word to the
+     * output shift register once, as it is
+     */
+    hstx_ctrl_hw->expand_shift =
+        (1u << HSTX_CTRL_EXPAND_SHIFT_RAW_N_SHIFTS_LSB) |
+        (0u << HSTX_CTRL_EXPAND_SHIFT_RAW_SHIFT_LSB);
+
     hstx_ctrl_hw->csr =
         HSTX_CTRL_CSR_EN_BITS |
+        (VIDEO_HSTX_EXPAND ? HSTX_CTRL_CSR_EXPAND_EN_BITS : 0) |
         (31u << HSTX_CTRL_CSR_SHIFT_LSB) |              // We have packed 2x 16 bit fields,
         (16u << HSTX_CTRL_CSR_N_SHIFTS_LSB);            // shift left, 1 bit/cycle, 16 times.
 
+    /* Sync scan line tables for the video standard and HSTX clock
+     */
+    scanline_init();
+
     /* Initialize DMA channel (do not enable yet)
      * Set up to transfer a whole pixes + sync buffer to HSTX.
      */
@@ -141,6 +172,7 @@ void io_init(void)
 
     c = dma_channel_get_default_config(DMA_CHAN_NUM);
     channel_config_set_dreq(&c, DREQ_HSTX);
+    channel_config_set_high_priority(&c, true);         // Keep HSTX FIFO fed while fill DMA runs
     channel_config_set_read_increment(&c, true);
     channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
     dma_channel_configure(
@@ -159,11 +191,38 @@ void io_init(void)
 
     dma_channel_set_irq0_enabled(DMA_CHAN_NUM, true);
 
+    /* Fill DMA channels. The control channel writes one line address
+     * at a time from a line table into the fill channel's write address trigger,
+     * the fill channel writes a constant word to the line and chains back.
+     * A NULL line address ends the chain and raises the (quiet mode) fill channel IRQ.
+     */
+    dma_channel_claim(FILL_DMA_CHAN);
+    dma_channel_claim(FILL_DMA_CTRL_CHAN);
+
+    c = dma_channel_get_default_config(FILL_DMA_CHAN);
+    channel_config_set_read_increment(&c, false);
+    channel_config_set_write_increment(&c, true);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+    channel_config_set_chain_to(&c, FILL_DMA_CTRL_CHAN);
+    channel_config_set_irq_quiet(&c, true);
+    dma_channel_configure(FILL_DMA_CHAN, &c, 0, &fill_value, 0, false);
+
+    c = dma_channel_get_default_config(FILL_DMA_CTRL_CHAN);
+    channel_config_set_read_increment(&c, true);
+    channel_config_set_write_increment(&c, false);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+    dma_channel_configure(FILL_DMA_CTRL_CHAN, &c, &dma_hw->ch[FILL_DMA_CHAN].al2_write_addr_trig, 0, 1, false);
+
+    irq_set_exclusive_handler(DMA_IRQ_1, dma_fill_irq_handler);
+    irq_set_enabled(DMA_IRQ_1, true);
+
+    dma_channel_set_irq1_enabled(FILL_DMA_CHAN, true);
+
     /* Enable DMA transfer
      */
-    dma_channel_set_read_addr(DMA_CHAN_NUM, vid_vert_sync, false);
+    dma_channel_set_read_addr(DMA_CHAN_NUM, vid_vert_sync_line.words, false);
     dma_channel_set_write_addr(DMA_CHAN_NUM, &hstx_fifo_hw->fifo, false);
-    dma_channel_set_trans_count(DMA_CHAN_NUM, SCAN_LINE_BUF_LEN, true);
+    dma_channel_set_trans_count(DMA_CHAN_NUM, vid_vert_sync_line.count, true);
 }
 
 /***************************************************************
@@ -201,62 +260,242 @@ uint16_t io_adc_read(void)
 }
 
 /***************************************************************
- * io_sound_on()
+ * io_timing_pin()
  * 
- *  Turn on (PWM) sound generation at a frequency pitch.
- *  Frequency = 600,000 / pitch for 150MHz system clock
+ *  Set timing outputpin state
  * 
- *  Param:  Frequency pitch constant
+ *  Param:  Pin state
  *  return: none
  * 
  */
-void io_sound_on(uint16_t pitch)
+void io_timing_pin(int state)
 {
-    pwm_set_wrap(pwn_slice_num, pitch);
-    pwm_set_chan_level(pwn_slice_num, PWM_CHAN_A, (pitch >> 1));
-    pwm_set_enabled(pwn_slice_num, 1);
+    gpio_put(GPIO_TIMING_PIN, state);
 }
 
 /***************************************************************
- * io_sound_off()
+ * io_is_vert_retrace()
  * 
- *  Turn off (PWM) sound generation
+ *  Return the frame scan phase
+ * 
+ *  Param:  none
+ *  return: True while in vertical sync, false when rendering.
+ * 
+ */
+int io_is_vert_retrace(void)
+{
+    return in_vert_retrace;
+}
+
+/***************************************************************
+ * io_wait_vsync()
+ * 
+ *  Sleep (WFE) until the start of the next vertical retrace.
+ *  Returns immediately if a retrace started since the last call.
+ *  Cycles spent waiting, less the scan line interrupt cycles taken
+ *  while waiting, are accumulated as idle time, so the interrupt
+ *  load is part of the CPU load.
  * 
  *  Param:  none
  *  return: none
  * 
  */
-void io_sound_off(void)
+void io_wait_vsync(void)
 {
-    pwm_set_enabled(pwn_slice_num, 0);
+    uint32_t    start;
+    uint32_t    isr_start;
+
+    start = io_get_cycles();
+    isr_start = isr_cycles;
+
+    while ( !vsync_pending )
+        __wfe();
+
+    vsync_pending = 0;
+
+    idle_cycles += (io_get_cycles() - start) - (isr_cycles - isr_start);
 }
 
 /***************************************************************
- * io_timing_pin()
+ * io_get_cycles()
  * 
- *  Set timing outputpin state
+ *  Return the CPU cycle counter. In RAM, the scan line
+ *  interrupt times every line with it.
  * 
- *  Param:  Pin state
+ *  Param:  none
+ *  return: Free running system clock cycle count
+ * 
+ */
+uint32_t __not_in_flash_func(io_get_cycles)(void)
+{
+    return m33_hw->dwt_cyccnt;
+}
+
+/***************************************************************
+ * io_get_vsync_cycles()
+ * 
+ *  Return the cycle counter at the start of the last vertical retrace
+ * 
+ *  Param:  none
+ *  return: CPU cycle count
+ * 
+ */
+uint32_t io_get_vsync_cycles(void)
+{
+    return vsync_cycles;
+}
+
+/***************************************************************
+ * io_get_vblank_cycles()
+ * 
+ *  Return the length of the vertical blanking window, from
+ *  the start of vertical retrace to the first active scan line.
+ * 
+ *  Param:  none
+ *  return: Window length in CPU cycles
+ * 
+ */
+uint32_t io_get_vblank_cycles(void)
+{
+    return vblank_cycles;
+}
+
+/***************************************************************
+ * io_get_line_cycles()
+ * 
+ *  Return the scan line period
+ * 
+ *  Param:  none
+ *  return: Scan line period in CPU cycles
+ * 
+ */
+uint32_t io_get_line_cycles(void)
+{
+    return line_cycles;
+}
+
+/***************************************************************
+ * io_get_load()
+ * 
+ *  Return CPU load figures accumulated since the last call
+ *  and start a new measurement period.
+ *  Measurement period must be shorter than 2^32 cycles (~28 sec at 150MHz).
+ * 
+ *  Param:  Pointer to load figures
  *  return: none
  * 
  */
-void io_timing_pin(int state)
+void io_get_load(io_load_t *load)
 {
-    gpio_put(GPIO_TIMING_PIN, state);
+    uint32_t    now;
+    uint32_t    irq_status;
+
+    irq_status = save_and_disable_interrupts();
+
+    now = io_get_cycles();
+
+    load->total_cycles = now - load_start;
+    load->idle_cycles = idle_cycles;
+    load->isr_cycles = isr_cycles;
+
+    load_start = now;
+    idle_cycles = 0;
+    isr_cycles = 0;
+
+    restore_interrupts(irq_status);
 }
 
 /***************************************************************
- * io_is_vert_retrace()
+ * io_is_odd_field()
  * 
- *  Return the frame scan phase
+ *  Return the parity of the field about to be scanned.
+ *  Valid while in vertical retrace. An odd field starts a new
+ *  interlaced frame, in progressive mode all fields are odd.
  * 
  *  Param:  none
- *  return: True while in vertical sync, false when rendering.
+ *  return: True if the next field is odd, false if even.
  * 
  */
-int io_is_vert_retrace(void)
+int io_is_odd_field(void)
 {
-    return in_vert_retrace;
+    return !is_even_field;
+}
+
+/***************************************************************
+ * io_get_tick_count()
+ * 
+ *  Return the count of game ticks (fields) since video started
+ * 
+ *  Param:  none
+ *  return: Tick count, incremented at the start of every vertical retrace
+ * 
+ */
+uint32_t io_get_tick_count(void)
+{
+    return tick_counter;
+}
+
+/***************************************************************
+ * io_dma_fill()
+ * 
+ *  Start a DMA fill of a list of line segments with a constant word.
+ *  Returns immediately, the fill runs in the background.
+ *  Waits for a previous fill to complete before starting.
+ * 
+ *  Param:  NULL terminated table of line segment addresses (must remain valid
+ *          until the fill completes), words per line segment, fill word value,
+ *          and optional callback called from the DMA IRQ when the fill is done.
+ *  return: none
+ * 
+ */
+void io_dma_fill(uint32_t * const *line_table, uint32_t word_count, uint32_t value, io_callback_t callback)
+{
+    while ( fill_busy )
+        tight_loop_contents();
+
+    if ( word_count == 0 || line_table[0] == 0 )
+    {
+        if ( callback )
+            callback();
+        return;
+    }
+
+    fill_value = value;
+    fill_callback = callback;
+    fill_busy = 1;
+
+    dma_channel_set_trans_count(FILL_DMA_CHAN, word_count, false);
+    dma_channel_set_read_addr(FILL_DMA_CTRL_CHAN, line_table, true);
+}
+
+/***************************************************************
+ * io_dma_fill_busy()
+ * 
+ *  Return DMA fill status
+ * 
+ *  Param:  none
+ *  return: True while a fill is in progress
+ * 
+ */
+int io_dma_fill_busy(void)
+{
+    return fill_busy;
+}
+
+/***************************************************************
+ * dma_fill_irq_handler()
+ * 
+ *  Triggered by the NULL line address at the end of a fill.
+ * 
+ */
+static void __not_in_flash_func(dma_fill_irq_handler)()
+{
+    dma_channel_acknowledge_irq1(FILL_DMA_CHAN);
+
+    fill_busy = 0;
+
+    if ( fill_callback )
+        fill_callback();
 }
 
 /***************************************************************
@@ -265,30 +504,43 @@ int io_is_vert_retrace(void)
  *  Triggered by DMA transfer completion.
  * 
  */
-static void dma_irq_handler()
+static void __not_in_flash_func(dma_irq_handler)()
 {
     static int          scan_line = 0;
-    static int          is_even_field = 1;
-    static uint32_t    *scan_line_buffer = vid_blank_scan_line;
-
-    uint32_t            transfer_count = 1;
+    static uint32_t    *next_scan_line;
+    static uint32_t     display_row;
+
+    const vid_line_t   *sync_line = 0;
+    const uint32_t     *scan_line_buffer;
+    uint32_t            transfer_count;
+    int                 compose = 0;
+    uint32_t            isr_start = m33_hw->dwt_cyccnt;
+    uint32_t            isr_time;
     
     /* Scan line 0 .. 2
      * Six pre-equalizing pulses
      */
     if ( scan_line < VERTICAL_SYNC )
     {
-        /* Will result in a vertical blanking signaled only
-         * when an odd field is about to be rendered.
-         * Effectively at a frame rate (~30Hz NTSC)
+        /* Vertical blanking is signaled before every field,
+         * at the game tick rate (~60Hz NTSC)
          */
-        if ( !is_even_field )
+        in_vert_retrace = 1;
+
+        if ( scan_line == PRE_EQUALIZING_PULSES )
         {
-            in_vert_retrace = 1;
+            tick_counter++;
+            vsync_cycles = isr_start;
+
+#if (TRACE == 1)
+            trace_record(TRACE_ISR, 0, isr_max_cycles);
+            isr_max_cycles = 0;
+#endif
+            vsync_pending = 1;
+            __sev();
         }
         
-        scan_line_buffer = vid_equalizing_pulse;
-        transfer_count = SCAN_LINE_BUF_LEN;
+        sync_line = &vid_equalizing_line;
     }
 
     /* Scan line 3 .. 5
@@ -296,8 +548,7 @@ static void dma_irq_handler()
      */
     else if ( scan_line < POST_EQUALIZING_PULSES )
     {
-        scan_line_buffer = vid_vert_sync;
-        transfer_count = SCAN_LINE_BUF_LEN;
+        sync_line = &vid_vert_sync_line;
     }
 
     /* Scan line 6 .. 8
@@ -305,15 +556,14 @@ static void dma_irq_handler()
      */
     else if ( scan_line < PRE_RENDER_BLANK_SCAN_LINE )
     {
-        scan_line_buffer = vid_equalizing_pulse;
-        transfer_count = SCAN_LINE_BUF_LEN;
+        sync_line = &vid_equalizing_line;
 
         /* Extent last post-equalizing pulse by half scan-line
-        * in an even field
+        * in an even field (interlaced only)
         */
         if ( scan_line == (PRE_RENDER_BLANK_SCAN_LINE - 1) && is_even_field )
         {
-            transfer_count += 24;
+            sync_line = &vid_equalizing_long_line;
         }
     }
 
@@ -322,29 +572,31 @@ static void dma_irq_handler()
      */
     else if ( scan_line < FIRST_ACTIVE_SCAN_LINE )
     {
-        scan_line_buffer = vid_blank_scan_line;
-        transfer_count = SCAN_LINE_BUF_LEN;
+        sync_line = &vid_blank_line;
+
+        /* Prepare the first active line of the field
+         */
+        if ( scan_line == (FIRST_ACTIVE_SCAN_LINE - 1) )
+        {
+            video_begin_field();
+            display_row = is_even_field ? (VIDEO_ROW_STEP - 1) : 0;
+            compose = 1;
+        }
     }
 
     /* Scan line 30 .. 245
-     * Video lines
+     * Video lines, prepared one line ahead
      */
-    else if ( scan_line == FIRST_ACTIVE_SCAN_LINE )
-    {
-        in_vert_retrace = 0;
-
-        if ( is_even_field )
-            scan_line_buffer = video_get_even_field();
-        else
-            scan_line_buffer = video_get_odd_field();
-        
-        transfer_count = SCAN_LINE_BUF_LEN;
-    }
-
     else if ( scan_line < POST_RENDER_BLANK_SCAN_LINE )
     {
-        scan_line_buffer += (2 * SCAN_LINE_BUF_LEN);
-        transfer_count = SCAN_LINE_BUF_LEN;
+        if ( scan_line == FIRST_ACTIVE_SCAN_LINE )
+            in_vert_retrace = 0;
+
+        if ( scan_line < (POST_RENDER_BLANK_SCAN_LINE - 1) )
+        {
+            display_row += VIDEO_ROW_STEP;
+            compose = 1;
+        }
     }
 
     /* Scan line 246 .. 261
@@ -352,19 +604,39 @@ static void dma_irq_handler()
      */
     else if ( scan_line < LAST_SCAN_LINE )
     {
-        scan_line_buffer = vid_blank_scan_line;
-        transfer_count = SCAN_LINE_BUF_LEN;
+        sync_line = &vid_blank_line;
     }
 
-    /* Insert half blank video line at end of odd field
+    /* Insert half blank video line at end of odd field,
+     * full blank line in progressive mode, and one blank
+     * word at the end of an even field
      */
     else
     {
-        if ( !is_even_field )
+        if ( VIDEO_SCAN_MODE == VIDEO_PROGRESSIVE )
+        {
+            sync_line = &vid_blank_line;
+        }
+        else if ( !is_even_field )
             {
-                scan_line_buffer = vid_blank_half_scan_line;
-                transfer_count = HALF_SCAN_LINE_BUF_LEN;
+                sync_line = &vid_blank_half_line;
             }
+        else
+            sync_line = &vid_blank_word_line;
+    }
+
+    /* Active lines are sent from the frame buffer or a line buffer,
+     * sync and blank lines as the scanline.c command lists or tables
+     */
+    if ( sync_line )
+    {
+        scan_line_buffer = sync_line->words;
+        transfer_count = sync_line->count;
+    }
+    else
+    {
+        scan_line_buffer = next_scan_line;
+        transfer_count = VID_ACTIVE_LINE_WORDS;
     }
 
     scan_line++;
@@ -372,7 +644,7 @@ static void dma_irq_handler()
     {
         scan_line = 0;
 
-        if ( is_even_field )
+        if ( is_even_field || VIDEO_SCAN_MODE == VIDEO_PROGRESSIVE )
             is_even_field = 0;
         else
             is_even_field = 1;
@@ -381,4 +653,18 @@ static void dma_irq_handler()
     dma_channel_acknowledge_irq0(DMA_CHAN_NUM);
     dma_channel_set_read_addr(DMA_CHAN_NUM, scan_line_buffer, false);
     dma_channel_set_trans_count(DMA_CHAN_NUM, transfer_count, true);
+
+    /* Compose the next active line while this one is sent
+     */
+    if ( compose )
+        next_scan_line = video_scan_line(display_row);
+
+    isr_time = m33_hw->dwt_cyccnt - isr_start;
+
+#if (TRACE == 1)
+    if ( isr_time > isr_max_cycles )
+        isr_max_cycles = isr_time;
+#endif
+
+    isr_cycles += isr_time;
 }
@@ -9,20 +9,59 @@
 
 #include    "io.h"
 #include    "video.h"
+#include    "runs.h"
+#include    "audio.h"
+#include    "sfx.h"
+#include    "sched.h"
 #include    "ponggame.h"
+#include    "stress.h"
+#include    "serial.h"
+#include    "fbstream.h"
+#include    "trace.h"
 
 /* ----------------------------------------------------------------------------
  * Global definitions
  */
 #define     VERSION     "v1.0"
+#define     LOAD_REPORT_PERIOD  TIME_10SEC  // CPU load report period in ticks
+#define     STRESS_STEP_PERIOD  (5 * TIME_1SEC) // Stress mode ball count step period in ticks
+
 /* ----------------------------------------------------------------------------
  * Function prototypes
  */
+static void telemetry(void);
 
 /* ----------------------------------------------------------------------------
  * Global variables
  */
-int     game_cycle_run = 0;
+
+/* Vertical blanking tasks. The blanking window is 30 scan lines (~1.9mSec).
+ * Input and physics, and sound, keep time and always run. Rendering
+ * is deferred to the next window if it does not fit, and the load report
+ * is printed outside the window.
+ */
+#if (STRESS_MODE == 1)
+static sched_task_t task_game =      { .name = "stress", .func = stress, .priority = SCHED_PRIO_CRITICAL, .budget_us = 200 };
+#else
+static sched_task_t task_game =      { .name = "game", .func = ponggame, .priority = SCHED_PRIO_CRITICAL, .budget_us = 50 };
+#endif
+static sched_task_t task_sfx =       { .name = "sfx", .func = sfx_tick, .priority = SCHED_PRIO_CRITICAL, .budget_us = 20 };
+static sched_task_t task_audio =     { .name = "audio", .func = audio_mix, .priority = SCHED_PRIO_CRITICAL, .budget_us = 300 };
+#if (STRESS_MODE == 1)
+static sched_task_t task_render =    { .name = "render", .func = stress_render, .priority = SCHED_PRIO_HIGH, .budget_us = 1000 };
+static sched_task_t task_stress =    { .name = "step", .func = stress_step, .priority = SCHED_PRIO_BACKGROUND,
+                                       .period = STRESS_STEP_PERIOD, .budget_us = 10000 };
+#else
+static sched_task_t task_render =    { .name = "render", .func = ponggame_render, .priority = SCHED_PRIO_HIGH, .budget_us = 1000 };
+#endif
+static sched_task_t task_telemetry = { .name = "telemetry", .func = telemetry, .priority = SCHED_PRIO_BACKGROUND,
+                                       .period = LOAD_REPORT_PERIOD, .budget_us = 10000 };
+#if (TRACE == 1)
+static sched_task_t task_trace =     { .name = "trace", .func = trace_drain, .priority = SCHED_PRIO_BACKGROUND, .budget_us = 500 };
+#endif
+#if (FBSTREAM == 1)
+static sched_task_t task_fbstream =  { .name = "fbstream", .func = fbstream, .priority = SCHED_PRIO_BACKGROUND, .budget_us = 5000 };
+#endif
 
 /***************************************************************
  * main()
@@ -30,31 +69,127 @@ int     game_cycle_run = 0;
  */
 int main()
 {
+    io_load_t   load;
+    uint32_t    line_cycles;
+    uint32_t    sprite_cycles;
+    uint32_t    start;
+
     io_init();
+    serial_init();
+#if (TRACE == 1)
+    trace_init();
+#endif
     video_init();
+    audio_init();
+    sfx_init();
+#if (STRESS_MODE == 1)
+    stress_init();
+#else
     ponggame_init();
+#endif
+    sched_init();
+
+    sched_add(&task_game);
+    sched_add(&task_sfx);
+    sched_add(&task_audio);
+    sched_add(&task_render);
+    sched_add(&task_telemetry);
+#if (STRESS_MODE == 1)
+    sched_add(&task_stress);
+#endif
+#if (TRACE == 1)
+    sched_add(&task_trace);
+#endif
+#if (FBSTREAM == 1)
+    fbstream_init();
+    sched_add(&task_fbstream);
+#endif
 
     printf("---- Starting -----\n");
+
+    /* Cost of a print, formatted into the serial transmit queue
+     */
+    start = io_get_cycles();
     printf("pico-pong %s %s %s\n", VERSION, __DATE__, __TIME__);
+    printf("stdio: printf %u cycles\n", (unsigned int)(io_get_cycles() - start));
 
+    /* Scan line composition cost, and the number of sprites
+     * on one line that would fill the scan line period
+     */
+    video_sprite_cost(&line_cycles, &sprite_cycles);
+    printf("sprites: %u cycles per line + %u per sprite, max %u sprites per line (line is %u cycles)\n",
+           (unsigned int)line_cycles, (unsigned int)sprite_cycles,
+           (unsigned int)((io_get_line_cycles() - line_cycles) / (sprite_cycles ? sprite_cycles : 1)),
+           (unsigned int)io_get_line_cycles());
+
+    io_get_load(&load);     // Start load measurement
+
+    /* Sleep until vertical retrace, then run the tick's tasks.
+     * The scan line interrupt wakes the CPU, so the loop
+     * re-checks and goes back to sleep until the retrace event.
+     */
     while (1)
     {
-        // gpio_put(PICO_DEFAULT_LED_PIN, 0);
-        // sleep_ms(1000);
-        // gpio_put(PICO_DEFAULT_LED_PIN, 1);
-        // sleep_ms(50);
-
-        if ( io_is_vert_retrace() )
-        {
-            if ( game_cycle_run )
-            {
-                ponggame();
-                game_cycle_run = 0;
-            }
-        }
-        else
-        {
-            game_cycle_run = 1;
-        }
+        io_wait_vsync();
+        sched_run();
     }
 }
+
+/* ----------------------------------------------------------------------------
+ * telemetry()
+ *
+ *  Print CPU load, scan line composition and task statistics.
+ *
+ *  Param:  none
+ *  return: none
+ *
+ */
+static void telemetry(void)
+{
+    io_load_t           load;
+    video_line_stats_t  line_stats;
+    serial_stats_t      serial_stats;
+#if (VIDEO_RUN_PLANE == 1)
+    runs_stats_t        run_stats;
+#endif
+#if (FBSTREAM == 1)
+    fbstream_stats_t    stream_stats;
+#endif
+
+    io_get_load(&load);
+    video_get_line_stats(&line_stats);
+
+    printf("load: cpu %u%% isr %u%%\n",
+           (unsigned int)((100ULL * (load.total_cycles - load.idle_cycles)) / load.total_cycles),
+           (unsigned int)((100ULL * load.isr_cycles) / load.total_cycles));
+
+    printf("scan line: max %u cycles, %u sprites\n",
+           (unsigned int)line_stats.max_cycles, (unsigned int)line_stats.max_sprites);
+
+#if (VIDEO_RUN_PLANE == 1)
+    runs_get_stats(&run_stats);
+    printf("runs: %u used, max %u of %u, %u spans dropped\n",
+           (unsigned int)run_stats.used, (unsigned int)run_stats.max_used,
+           (unsigned int)VIDEO_RUNS, (unsigned int)run_stats.drops);
+#endif
+
+#if (TRACE == 1)
+    printf("trace: %u records dropped\n", (unsigned int)trace_get_drops());
+#endif
+
+#if (FBSTREAM == 1)
+    fbstream_get_stats(&stream_stats);
+    printf("fbstream: %u bytes per frame avg, %u max, budget %u, %u lines pending\n",
+           (unsigned int)(stream_stats.frames ? stream_stats.bytes / stream_stats.frames : 0),
+           (unsigned int)stream_stats.max_frame_bytes,
+           (unsigned int)((serial_bytes_per_tick() * FBSTREAM_BANDWIDTH) / 100),
+           (unsigned int)stream_stats.rows_pending);
+#endif
+
+    serial_get_stats(&serial_stats);
+    printf("serial: %u bytes, max %u queued, %u writes and %u lines dropped\n",
+           (unsigned int)serial_stats.bytes, (unsigned int)serial_stats.max_used,
+           (unsigned int)serial_stats.drops, (unsigned int)serial_stats.lines_dropped);
+
+    sched_print_stats();
+}
@@ -8,11 +8,16 @@
 #include    <stdio.h>
 
 #include    "pico/stdlib.h"
+#include    "hardware/clocks.h"
 
 #include    "ponggame.h"
 #include    "video.h"
 #include    "io.h"
+#include    "sfx.h"
 #include    "sprites.h"
+#include    "bricks.h"
+#include    "entity.h"
+#include    "trace.h"
 
 /* ----------------------------------------------------------------------------
  * Module definitions
@@ -23,7 +28,7 @@
 #define     BITBLIT_MODE        FLIP
 #define     MAX_LIVES           3
 #define     MAX_SCORE           99
-#define     SCORE_X_POS         300
+#define     SCORE_X_OFFSET      12      // From screen center
 #define     SCORE_Y_POS         50
 #define     LIVES_X_POS         300
 #define     LIVES_Y_POS         30
@@ -31,7 +36,8 @@
 #define     PADDLE_MIN          1526    // Measured
 #define     PADDLE_MAX          2500    // Measure
 
-#define     BALL_SPEED          5       // Pixel movement per cycle (frame rate)
+#define     BALL_SPEED          150     // Pixel movement per second on a BALL_SPEED_X_RES wide screen
+#define     BALL_SPEED_X_RES    576
 
 #define     SERVE_CYCLE         20      // Counter max value used to "randomize" serve direction
 #define     NOSERVE             0       // Serve flag
@@ -42,23 +48,42 @@
 #define     LEFT                1
 #define     RIGHT               2
 
-#define     SOUNDOFF            0       // Flag which sound to produce
-#define     SOUNDACTIVE         1       // Sound is already playing
-#define     SOUNDOUT            2
-#define     SOUNDPADDLE         3
-#define     SOUNDWALL           4
-#define     BEEPOUT             3000    // 200Hz  <-- frequency = 600,000 / BEEP*
-#define     BEEPPADDLE          400     // 1500Hz
-#define     BEEPWALL            300     // 2000Hz
+#define     BEEPOUT             200     // Hz
+#define     BEEPPADDLE          1500
+#define     BEEPWALL            2000
+#define     BEEP_VOLUME         192
 #define     LONGBEEP            (4*TIME_100MSEC)
 #define     SHORTBEEP           TIME_100MSEC
 
+#define     TITLE_TIME          (3 * TIME_1SEC)
+
+#define     BREAKOUT_COLS       6       // Brick columns in breakout mode
+#define     BRICK_COL_SHIFT     4       // Brick cell is 16 pixels wide, one frame buffer word
+#define     BRICK_ROW_SHIFT     5       // and 32 pixels tall
+#if (BREAKOUT_MODE == 1)
+#define     WALL_X              0       // Ball bounces off the screen edge behind the bricks
+#define     BORDER_X            (BREAKOUT_COLS << BRICK_COL_SHIFT)
+#else
+#define     WALL_X              (3 * SPRITE_BRICK_COLS)
+#define     BORDER_X            WALL_X
+#endif
+
+#define     PADDLE_SPRITE       0       // Video sprite numbers
+#define     BALL_SPRITE         1
+#define     PADDLE_PRIORITY     1       // Ball is drawn over the paddle
+#define     BALL_PRIORITY       2
+
 /* ----------------------------------------------------------------------------
  * Module function prototypes
  */
-static void ponggame_bresenham(void);
+static void ponggame_ball_aim(int x1, int y1);
+static void ponggame_ball_bounce(int flip_x, int flip_y);
+static void ponggame_title(void);
+#if (BREAKOUT_MODE == 1)
+static int  ponggame_hit_brick(void);
+static void ponggame_draw_bricks(void);
+#endif
 static void ponggame_draw_paddle(int x, int y);
-static void ponggame_draw_ball(int x, int y);
 static void ponggame_draw_score(int score);
 static void ponggame_render_score(uint32_t x, uint32_t y, int score);
 
@@ -67,6 +92,8 @@ static void ponggame_render_score(uint32_t x, uint32_t y, int score);
  */
 static bit_blit_t   a_bit_map;
 static uint32_t     max_x_res, max_y_res;
+static uint32_t     score_x_pos;
+static int          ball_speed;                     // Pixel movement per second, scaled to screen width
 static int          score;
 
 /* Paddle
@@ -74,27 +101,58 @@ static int          score;
 static uint32_t     paddle_x_pos, paddle_y_pos;     // Paddle center!
 static uint32_t     ratio;
 
-/* Ball movement
+/* Ball movement. The ball's position and velocity are kept in the entity
+ * store, which moves it and its sprite, the game bounces it.
  */
-static int          ball_x0, ball_y0;               // Start and end coordinates of ball center movement trajectory line
-static int          ball_x1, ball_y1;
-static int          dx, sx;                         // Bresenham's line algorithm variables,
-static int          dy, sy;                         // These are globals so that ball position is maintained between calls to ponggame()
-static int          err, e2;
+static int          ball;                           // Ball entity
+static int          ball_x0, ball_y0;               // Ball center at the start of the tick
 static int          serve_offset = -SERVE_CYCLE;    // Cycles from 1 to SERVECYCLE and used to pick serve direction (X1,Y1)
 static int          serve_dir = UP;                 // Serve direction UP or DOWN
-static uint32_t     cycle_count = 0;                // Count game cycles, ~60 cycles per second
+static uint32_t     cycle_count = 0;                // Count game cycles, one per tick
 static int          serve_flag = SERVE;             // Is it time to serve a new game? 0=no, 1=from-right, 2=from-left
-static int          sound_flag = SOUNDOFF;
-static int          sound_duration = 0;
+static int          ball_prev_x, ball_prev_y;       // Ball center before the last move
+
+/* Breakout mode brick wall. Bricks hit by the game are erased
+ * by the renderer, and a cleared wall is redrawn one row per frame.
+ */
+#if (BREAKOUT_MODE == 1)
+static bricks_t     wall;
+static uint32_t     wall_erase[BRICKS_MAX_ROWS];    // Bricks to erase, bit per column
+static int          wall_draw_row = BRICKS_MAX_ROWS; // Next row to draw, rows done when past the wall
+#endif
+
+/* Sound effects
+ */
+static const audio_envelope_t beep_envelope =
+{
+    .attack = 0,
+    .decay = 1,
+    .sustain = 192,
+    .release = 1,
+};
+
+static const sfx_note_t notes_paddle[] = { { BEEPPADDLE, 0, SHORTBEEP } };
+static const sfx_note_t notes_wall[] =   { { BEEPWALL, 0, SHORTBEEP } };
+static const sfx_note_t notes_out[] =
+{
+    { (2 * BEEPOUT), 0, SHORTBEEP },
+    { SFX_REST, 0, 1 },
+    { (3 * BEEPOUT / 2), 0, SHORTBEEP },
+    { SFX_REST, 0, 1 },
+    { BEEPOUT, -(BEEPOUT / LONGBEEP / 2), LONGBEEP },
+};
+
+static const sfx_t sfx_paddle = { notes_paddle, count_of(notes_paddle), 1, BEEP_VOLUME, AUDIO_SQUARE, &beep_envelope };
+static const sfx_t sfx_wall =   { notes_wall, count_of(notes_wall), 1, BEEP_VOLUME, AUDIO_SQUARE, &beep_envelope };
+static const sfx_t sfx_out =    { notes_out, count_of(notes_out), 2, BEEP_VOLUME, AUDIO_SQUARE, &beep_envelope };
 
 /***************************************************************
  * ponggame()
  * 
  *  Pong game module.
- *  Call this module periodically when the display in in vertical blanking state.
- *  Called from pico-pong.c module every other field, at a 30Hz call rate.
- *  Must complete within 1.9mSec, timeing of 30 scan lines of VSYNC + blank overscan.
+ *  Paddle input and ball movement, run as a critical vertical blanking
+ *  task once per field at the 60Hz tick rate. Drawing is done separately
+ *  by ponggame_render().
  * 
  *  Param:  none
  *  return: none
@@ -104,15 +162,12 @@ void  ponggame(void)
 {
     static uint32_t     temp_y_paddle;
     int                 pos_diff;
-    int                 ball_x0_tmp, ball_y0_tmp;
+    int32_t             vx, vy;
 
 #if (IO_TIMING==1)
     io_timing_pin(1);
 #endif
 
-    ball_x0_tmp = ball_x0;
-    ball_y0_tmp = ball_y0;
-
     /* Place paddle
      */
     temp_y_paddle = (io_adc_read() - PADDLE_MIN) / ratio;
@@ -120,11 +175,7 @@ void  ponggame(void)
     pos_diff = temp_y_paddle - paddle_y_pos;
 
     if ( abs(pos_diff) > PADDLE_POS_HYST )
-    {
-        ponggame_draw_paddle(paddle_x_pos, paddle_y_pos);
         paddle_y_pos = temp_y_paddle;
-        ponggame_draw_paddle(paddle_x_pos, paddle_y_pos);
-    }
 
     /* Use this to generate some randomness in ball serving angle
      */
@@ -133,6 +184,11 @@ void  ponggame(void)
         serve_offset = -SERVE_CYCLE;
     serve_dir = (serve_dir==UP) ? DOWN : UP;
 
+    entity_get_pos(ball, &ball_x0, &ball_y0);
+    ball_x0 += SPRITE_BALL_COLS / 2;
+    ball_y0 += SPRITE_BALL_ROWS / 2;
+    entity_get_vel(ball, &vx, &vy);
+
     /* Ball movement and action state machine
      */
     switch ( serve_flag )   // Determine what to do with the next move
@@ -146,56 +202,66 @@ void  ponggame(void)
          */
         if ( ball_x0 >= max_x_res )
         {
-            ponggame_draw_ball(ball_x0, ball_y0); // Clear ball
             score--;
             if ( score < 0 )
                 score = 0;
-            sound_flag = SOUNDOUT;
+            TRACE_EVENT(TRACE_SCORE, 0, score);
+            sfx_play(&sfx_out);
+            entity_set_vel(ball, 0, 0);
             serve_flag = SERVE;
         }
 
         /* Ball reached the paddle
          */
-        else if ( ( ball_x0 + (SPRITE_BALL_COLS / 2)) >= paddle_x_pos &&
+        else if ( vx > 0 &&
+                ( ball_x0 + (SPRITE_BALL_COLS / 2)) >= paddle_x_pos &&
                 ball_y0 <= (paddle_y_pos + (SPRITE_PADDLE_LENGTH / 2)) &&
                 ball_y0 >= (paddle_y_pos - (SPRITE_PADDLE_LENGTH / 2)) )
         {
-            ball_x0 -= sx;
-            ball_y0 += sy;
-            ball_y1 = (sy > 0) ? (max_y_res - 1) : 2;  // Top or bottom of screen
-            ball_x1 = ball_x0 + ((-1 * sx * abs(ball_y0-ball_y1) * dx) / dy);
-            ponggame_bresenham();
+            ponggame_ball_bounce(1, 0);
             score++;
-            sound_flag = SOUNDPADDLE;
+            TRACE_EVENT(TRACE_BOUNCE, TRACE_BOUNCE_PADDLE, ((uint32_t)ball_y0 << 16) | (uint16_t)ball_x0);
+            TRACE_EVENT(TRACE_SCORE, 0, score);
+            sfx_play(&sfx_paddle);
+            serve_flag = NOSERVE;
+        }
+
+#if (BREAKOUT_MODE == 1)
+        /* Hit a brick, remove it and
+         * reverse X trajectory
+         */
+        else if ( ponggame_hit_brick() )
+        {
+            ponggame_ball_bounce(1, 0);
+            if ( score < MAX_SCORE )
+                score++;
+            TRACE_EVENT(TRACE_BOUNCE, TRACE_BOUNCE_BRICK, ((uint32_t)ball_y0 << 16) | (uint16_t)ball_x0);
+            TRACE_EVENT(TRACE_SCORE, 0, score);
+            sfx_play(&sfx_wall);
             serve_flag = NOSERVE;
         }
+#endif
 
         /* Reached left side wall
          * reverse X trajectory
          */
-        else if ( (ball_x0 - (SPRITE_BALL_COLS / 2)) <= (3 * SPRITE_BRICK_COLS) )
+        else if ( vx < 0 && (ball_x0 - (SPRITE_BALL_COLS / 2)) <= WALL_X )
         {
-            ball_x0 -= sx;
-            ball_y0 += sy;
-            ball_y1 = (sy > 0) ? (max_y_res - 1) : 2;   // Top or bottom of screen
-            ball_x1 = ball_x0 + ((-1 * sx * abs(ball_y0-ball_y1) * dx) / dy);
-            ponggame_bresenham();
-            sound_flag = SOUNDWALL;
+            ponggame_ball_bounce(1, 0);
+            TRACE_EVENT(TRACE_BOUNCE, TRACE_BOUNCE_WALL, ((uint32_t)ball_y0 << 16) | (uint16_t)ball_x0);
+            sfx_play(&sfx_wall);
             serve_flag = NOSERVE;
         }
 
         /* Reached top or bottom of game board
          * reverse Y trajectory
          */
-        else if ( ball_y0 <= (SPRITE_BALL_ROWS / 2) ||
-                    ball_y0 >= (max_y_res - (SPRITE_BALL_ROWS / 2)) )
+        else if ( (vy < 0 && ball_y0 <= (SPRITE_BALL_ROWS / 2)) ||
+                  (vy > 0 && ball_y0 >= (max_y_res - (SPRITE_BALL_ROWS / 2))) )
         {
-            ball_x0 += sx;
-            ball_y0 -= sy;
-            ball_x1 = (sx > 0) ? paddle_x_pos : (3 * SPRITE_BRICK_COLS);    // *** paddle_x_pos: need to account for X movement of paddle!!
-            ball_y1 = ball_y0 + ((-1 * sy * abs(ball_x0-ball_x1) * dy) / dx);
-            ponggame_bresenham();
-            sound_flag = SOUNDWALL;
+            ponggame_ball_bounce(0, 1);
+            TRACE_EVENT(TRACE_BOUNCE, TRACE_BOUNCE_EDGE, ((uint32_t)ball_y0 << 16) | (uint16_t)ball_x0);
+            sfx_play(&sfx_wall);
             serve_flag = NOSERVE;
         }
         break;
@@ -203,97 +269,120 @@ void  ponggame(void)
     /* Serve new ball from the right
      */
     case SERVE:
-        if ( sound_flag != SOUNDOFF )                       // Wait for 'out' sound to complete
+        if ( sfx_is_playing(&sfx_out) )                    // Wait for 'out' sound to complete
            break;
 
         ball_x0 = paddle_x_pos - SPRITE_BALL_COLS;          // Serve from center of paddle
         ball_y0 = paddle_y_pos;
-        ball_x1 = (max_x_res / 2) + serve_offset;
-        ball_y1 = (serve_dir == UP) ? 2 : (max_y_res - 2);  // Top or bottom of screen
-        ponggame_bresenham();
-        sound_flag = SOUNDPADDLE;
+        entity_set_pos(ball, ENTITY_TO_FIXED(ball_x0 - (SPRITE_BALL_COLS / 2)), ENTITY_TO_FIXED(ball_y0 - (SPRITE_BALL_ROWS / 2)));
+        ponggame_ball_aim(((max_x_res / 2) + serve_offset), ((serve_dir == UP) ? 2 : (max_y_res - 2)));
+        sfx_play(&sfx_paddle);
         serve_flag = NOSERVE;
-
-        ball_x0_tmp = ball_x0;
-        ball_y0_tmp = ball_y0;
-        ponggame_draw_ball(ball_x0, ball_y0);
         break;
     }
 
-    for ( int i = 0; i < BALL_SPEED; i++ )
-    {
-        e2 = err;                                       // Calculate new ball location
-        if (e2 >-dx) { err -= dy; ball_x0 += sx; }
-        if (e2 < dy) { err += dx; ball_y0 += sy; }
-    }
+    ball_prev_x = ball_x0;
+    ball_prev_y = ball_y0;
 
-    if ( serve_flag == NOSERVE )
-    {
-        ponggame_draw_ball(ball_x0_tmp, ball_y0_tmp);   // Clear current ball location
-        ponggame_draw_ball(ball_x0, ball_y0);           // Put ball in new location
-    }
-
-    /* Update score
+    /* Move the ball. The bounding box is past the screen edges, so the
+     * store does not bounce the ball before the game sees it reach an edge.
      */
-    ponggame_draw_score(score);
+    entity_update(-SPRITE_BALL_COLS, -SPRITE_BALL_ROWS, (max_x_res + 1), (max_y_res + 1));
 
-    /* Generate sound
-     */
-    switch ( sound_flag )
-    {
-    case SOUNDOFF:
-        io_sound_off();
-        break;
+    cycle_count++;
 
-    case SOUNDACTIVE:
-        sound_duration--;
-        if (sound_duration == 0 )
-            sound_flag = SOUNDOFF;
-        break;
+#if (IO_TIMING==1)
+    sleep_us(20);
+    io_timing_pin(0);
+#endif
+}
 
-    case SOUNDPADDLE:
-        sound_duration = SHORTBEEP;
-        io_sound_on(BEEPPADDLE);
-        sound_flag = SOUNDACTIVE;
-        break;
+/* ----------------------------------------------------------------------------
+ * ponggame_ball_aim()
+ *
+ *  Set the ball's velocity from its center towards a point, moving
+ *  ball_speed pixels per second along the longer axis.
+ *
+ *  Param:  Point to aim at
+ *  return: none
+ * 
+ */
+static void ponggame_ball_aim(int x1, int y1)
+{
+    int32_t     dx = abs(x1 - ball_x0);
+    int32_t     dy = abs(y1 - ball_y0);
+    int32_t     speed = ENTITY_TO_FIXED(ball_speed) / TIME_1SEC;
+    int32_t     vx, vy;
 
-    case SOUNDWALL:
-        sound_duration = SHORTBEEP;
-        io_sound_on(BEEPWALL);
-        sound_flag = SOUNDACTIVE;
-        break;
+    if ( dx == 0 && dy == 0 )
+        dx = 1;
 
-    case SOUNDOUT:
-        sound_duration = LONGBEEP;
-        io_sound_on(BEEPOUT);
-        sound_flag = SOUNDACTIVE;
-        break;
+    if ( dx >= dy )
+    {
+        vx = speed;
+        vy = (speed * dy) / dx;
+    }
+    else
+    {
+        vx = (speed * dx) / dy;
+        vy = speed;
     }
 
-    cycle_count++;
+    entity_set_vel(ball, ((x1 < ball_x0) ? -vx : vx), ((y1 < ball_y0) ? -vy : vy));
+}
 
-#if (IO_TIMING==1)
-    sleep_us(20);
-    io_timing_pin(0);
-#endif
+/* ----------------------------------------------------------------------------
+ * ponggame_ball_bounce()
+ *
+ *  Reverse the ball's horizontal or vertical direction
+ *
+ *  Param:  Reverse horizontal, reverse vertical
+ *  return: none
+ * 
+ */
+static void ponggame_ball_bounce(int flip_x, int flip_y)
+{
+    int32_t     vx, vy;
+
+    entity_get_vel(ball, &vx, &vy);
+    entity_set_vel(ball, (flip_x ? -vx : vx), (flip_y ? -vy : vy));
 }
 
 /* ----------------------------------------------------------------------------
- * ponggame_bresenman()
+ * ponggame_title()
  *
- *  Calculate ball line trajectory using Bresenham's algorithm
+ *  Show the title screen for TITLE_TIME, and print its
+ *  compression and decode time.
  *
  *  Param:  none
  *  return: none
  * 
  */
-static void ponggame_bresenham(void)
+static void ponggame_title(void)
 {
-    dx = abs(ball_x1-ball_x0);
-    sx = ball_x0<ball_x1 ? 1 : -1;
-    dy = abs(ball_y1-ball_y0);
-    sy = ball_y0<ball_y1 ? 1 : -1;
-    err = (dx>dy ? dx : -dy)/2;
+    uint32_t    start;
+    uint32_t    cycles;
+    uint32_t    cycles_per_usec;
+    uint32_t    ratio_x10;                  // Compression ratio in tenths
+
+    video_clear_screen(SCREEN_BACKGROUND);
+
+    start = io_get_cycles();
+    video_rle_image(((max_x_res + 1 - IMAGE_TITLE_COLS) / 2), ((max_y_res + 1 - IMAGE_TITLE_ROWS) / 2), &image_title);
+    cycles = io_get_cycles() - start;
+
+    cycles_per_usec = clock_get_hz(clk_sys) / 1000000;
+
+    ratio_x10 = (((((IMAGE_TITLE_COLS + 7) / 8) * IMAGE_TITLE_ROWS) * 10) + (image_title.size / 2)) / image_title.size;
+
+    printf("title: %ux%u, %u bytes RLE (%u.%u:1), decoded in %u uS, vertical blanking is %u uS\n",
+           IMAGE_TITLE_COLS, IMAGE_TITLE_ROWS, (unsigned int)image_title.size,
+           (unsigned int)(ratio_x10 / 10), (unsigned int)(ratio_x10 % 10),
+           (unsigned int)(cycles / cycles_per_usec),
+           (unsigned int)(io_get_vblank_cycles() / cycles_per_usec));
+
+    for ( int i = 0; i < TITLE_TIME; i++ )
+        io_wait_vsync();
 }
 
 /* ----------------------------------------------------------------------------
@@ -311,16 +400,55 @@ void ponggame_init(void)
      */
     max_x_res = video_get_x_res();
     max_y_res = video_get_y_res();
+    score_x_pos = ((max_x_res + 1) / 2) + SCORE_X_OFFSET;
+    ball_speed = (BALL_SPEED * (max_x_res + 1)) / BALL_SPEED_X_RES;
     score = 0;
     paddle_x_pos = max_x_res - SPRITE_PADDLE_COLS;
     paddle_y_pos = max_y_res / 2;
     ratio = (PADDLE_MAX - PADDLE_MIN) / max_y_res;
 
-    /* Draw game board
+    entity_init();
+    ball = entity_add(0, 0, 0, 0, &sprite_ball_image, BALL_SPRITE);
+
+    /* Draw game board on the static plane,
+     * the score is on the dynamic plane
      */
+    video_set_plane(VIDEO_PLANE_DYNAMIC);
+    video_clear_screen(SCREEN_BACKGROUND);
+    video_set_plane(VIDEO_PLANE_STATIC);
+
+    ponggame_title();
+
     video_clear_screen(SCREEN_BACKGROUND);
     video_set_default_action(BITBLIT_MODE);
 
+#if (VIDEO_TILE_MAP == 1)
+    if ( video_tile_set(tile_set, TILE_SET_COUNT) != 0 )
+        printf("tiles: %u tiles, more than VIDEO_TILES %u\n", TILE_SET_COUNT, VIDEO_TILES);
+#endif
+
+#if (BREAKOUT_MODE == 1)
+    bricks_init(&wall, 0, 0, BRICK_COL_SHIFT, BRICK_ROW_SHIFT, BREAKOUT_COLS, ((max_y_res + 1) >> BRICK_ROW_SHIFT));
+    bricks_fill(&wall);
+
+    for ( wall_draw_row = 0; wall_draw_row < wall.rows; )
+        ponggame_draw_bricks();
+#elif (VIDEO_TILE_MAP == 1)
+    int bricks = (max_y_res + 1 - SPRITE_HALF_BRICK_ROWS) / SPRITE_BRICK_ROWS;
+
+    video_tile_block(0, 0, TILE_LOWER_HALF_BRICK, TILE_BRICK_COLS, TILE_HALF_BRICK_ROWS);
+    video_tile_block(2 * TILE_BRICK_COLS, 0, TILE_LOWER_HALF_BRICK, TILE_BRICK_COLS, TILE_HALF_BRICK_ROWS);
+    video_tile_block(TILE_BRICK_COLS, bricks * TILE_BRICK_ROWS, TILE_BRICK, TILE_BRICK_COLS, TILE_HALF_BRICK_ROWS);
+
+    for ( int i = 0; i < bricks; i++ )
+    {
+        video_tile_block(0, TILE_HALF_BRICK_ROWS + (i * TILE_BRICK_ROWS), TILE_BRICK, TILE_BRICK_COLS, TILE_BRICK_ROWS);
+        video_tile_block(TILE_BRICK_COLS, i * TILE_BRICK_ROWS, TILE_BRICK, TILE_BRICK_COLS, TILE_BRICK_ROWS);
+        video_tile_block(2 * TILE_BRICK_COLS, TILE_HALF_BRICK_ROWS + (i * TILE_BRICK_ROWS), TILE_BRICK, TILE_BRICK_COLS, TILE_BRICK_ROWS);
+    }
+#else
+    int bricks = (max_y_res + 1 - SPRITE_HALF_BRICK_ROWS) / SPRITE_BRICK_ROWS;
+
     a_bit_map.col_count = SPRITE_HALF_BRICK_COLS;
     a_bit_map.row_count = SPRITE_HALF_BRICK_ROWS;
     a_bit_map.bitmap = &sprite_brick[SPRITE_BRICK_ROWS];
@@ -329,79 +457,193 @@ void ponggame_init(void)
     video_bit_blit(2 * SPRITE_BRICK_COLS, 0, &a_bit_map);
 
     a_bit_map.bitmap = sprite_brick;
-    
-    video_bit_blit(SPRITE_BRICK_COLS, 13 * SPRITE_BRICK_ROWS, &a_bit_map);
+
+    video_bit_blit(SPRITE_BRICK_COLS, bricks * SPRITE_BRICK_ROWS, &a_bit_map);
 
     a_bit_map.col_count = SPRITE_BRICK_COLS;
     a_bit_map.row_count = SPRITE_BRICK_ROWS;
 
-    for ( int i = 0; i < 13; i++ )
+    for ( int i = 0; i < bricks; i++ )
     {
         video_bit_blit(0, SPRITE_HALF_BRICK_ROWS + (i * SPRITE_BRICK_ROWS), &a_bit_map);
         video_bit_blit(SPRITE_BRICK_COLS, i * SPRITE_BRICK_ROWS, &a_bit_map);
         video_bit_blit(2 * SPRITE_BRICK_COLS, SPRITE_HALF_BRICK_ROWS + (i * SPRITE_BRICK_ROWS), &a_bit_map);
     }
+#endif
 
-    video_line(3 * SPRITE_BRICK_COLS, 0, max_x_res, 0);
-    video_line(3 * SPRITE_BRICK_COLS, max_y_res, max_x_res, max_y_res);
+    video_line(BORDER_X, 0, max_x_res, 0);
+    video_line(BORDER_X, max_y_res, max_x_res, max_y_res);
 
-    a_bit_map.col_count = SPRITE_NUMBERS_COLS;
-    a_bit_map.row_count = SPRITE_NUMBERS_ROWS;
-    a_bit_map.bitmap = sprite_numbers;
-    video_bit_blit(SCORE_X_POS, SCORE_Y_POS, &a_bit_map);
+    video_sprite_set(PADDLE_SPRITE, &sprite_paddle_image, sprite_paddle_mask, PADDLE_PRIORITY);
+    video_sprite_set(BALL_SPRITE, &sprite_ball_image, sprite_ball_mask, BALL_PRIORITY);
 
     ponggame_draw_paddle(paddle_x_pos, paddle_y_pos);
+    video_sprite_enable(PADDLE_SPRITE, 1);
     ponggame_draw_score(score);
 }
 
-/* ----------------------------------------------------------------------------
- * ponggame_draw_paddle()
+/***************************************************************
+ * ponggame_render()
  *
- *  Draw paddle on game board given paddle center point
+ *  Bring the screen up to date with the game state.
+ *  Paddle and ball are sprites and are moved every tick.
+ *  The score is redrawn on the dynamic plane once per frame,
+ *  before the odd field.
  *
- *  Param:  Paddle center point coordinates
+ *  Param:  none
  *  return: none
  * 
  */
-static void ponggame_draw_paddle(int x, int y)
+void ponggame_render(void)
 {
-    if ( y < (SPRITE_PADDLE_LENGTH / 2) )
-        y = SPRITE_PADDLE_LENGTH / 2;
-    else if ( y > (max_y_res - SPRITE_PADDLE_LENGTH) )
-        y = max_y_res - SPRITE_PADDLE_LENGTH + 8;
+    ponggame_draw_paddle(paddle_x_pos, paddle_y_pos);
 
-    a_bit_map.col_count = SPRITE_PADDLE_COLS;
-    a_bit_map.row_count = SPRITE_PADDLE_ROWS;
-    a_bit_map.bitmap = sprite_paddle;
+    if ( serve_flag == NOSERVE )
+    {
+        entity_draw();
+        video_sprite_enable(BALL_SPRITE, 1);
+    }
+    else
+    {
+        video_sprite_enable(BALL_SPRITE, 0);
+    }
+
+    if ( io_is_odd_field() )
+        ponggame_draw_score(score);
+
+#if (BREAKOUT_MODE == 1)
+    ponggame_draw_bricks();
+#endif
+}
+
+#if (BREAKOUT_MODE == 1)
+/* ----------------------------------------------------------------------------
+ * ponggame_hit_brick()
+ *
+ *  Test the ball's swept bounding box, from its center before and after the
+ *  last move, against the brick wall. A hit brick is removed from the wall and
+ *  queued for erasing, and a cleared wall is filled again.
+ *
+ *  Param:  none
+ *  return: 1 if the ball hit a brick, 0 if not
+ * 
+ */
+static int ponggame_hit_brick(void)
+{
+    int     col, row;
+
+    if ( !bricks_collide(&wall,
+                         (((ball_prev_x < ball_x0) ? ball_prev_x : ball_x0) - (SPRITE_BALL_COLS / 2)),
+                         (((ball_prev_y < ball_y0) ? ball_prev_y : ball_y0) - (SPRITE_BALL_ROWS / 2)),
+                         (((ball_prev_x > ball_x0) ? ball_prev_x : ball_x0) + (SPRITE_BALL_COLS / 2)),
+                         (((ball_prev_y > ball_y0) ? ball_prev_y : ball_y0) + (SPRITE_BALL_ROWS / 2)),
+                         &col, &row) )
+        return 0;
+
+    wall_erase[row] |= 1UL << col;
+
+    if ( bricks_count(&wall) == 0 )
+    {
+        bricks_fill(&wall);
+        wall_draw_row = 0;
+    }
 
-    video_bit_blit((x - SPRITE_PADDLE_CENTER), (y - SPRITE_PADDLE_LENGTH / 2), &a_bit_map);
+    return 1;
 }
 
 /* ----------------------------------------------------------------------------
- * ponggame_draw_ball()
+ * ponggame_draw_bricks()
  *
- *  Draw ball on game board given ball center point
+ *  Erase bricks removed by the game, each with a single word aligned
+ *  clear of its cell, and draw one row of a refilled wall.
  *
- *  Param:  Ball center point coordinates
+ *  Param:  none
  *  return: none
  * 
  */
-static void ponggame_draw_ball(int x, int y)
+static void ponggame_draw_bricks(void)
 {
-    if ( x < (SPRITE_BALL_COLS / 2) && y < (SPRITE_BALL_ROWS / 2))
-        return;
+    uint32_t    x, y;
+    int         col;
 
-    a_bit_map.col_count = SPRITE_BALL_COLS;
-    a_bit_map.row_count = SPRITE_BALL_ROWS;
-    a_bit_map.bitmap = sprite_ball;
+    for ( int row = 0; row < wall.rows; row++ )
+    {
+        while ( wall_erase[row] )
+        {
+            col = __builtin_ctz(wall_erase[row]);
+            wall_erase[row] &= ~(1UL << col);
+
+            x = wall.x0 + (col << BRICK_COL_SHIFT);
+            y = wall.y0 + (row << BRICK_ROW_SHIFT);
+#if (VIDEO_TILE_MAP == 1)
+            video_tile_fill((x / VIDEO_TILE_SIZE), (y / VIDEO_TILE_SIZE), TILE_BRICK_COLS, TILE_BRICK_ROWS, 0);
+#else
+            video_fill_rect(x, y, (x + (1 << BRICK_COL_SHIFT) - 1), (y + (1 << BRICK_ROW_SHIFT) - 1), SCREEN_BACKGROUND, 0);
+#endif
+        }
+    }
+
+#if (VIDEO_TILE_MAP == 1)
+    if ( wall_draw_row < wall.rows )
+    {
+        for ( col = 0; col < wall.cols; col++ )
+        {
+            x = wall.x0 + (col << BRICK_COL_SHIFT);
+            y = wall.y0 + (wall_draw_row << BRICK_ROW_SHIFT);
+            if ( bricks_test(&wall, col, wall_draw_row) )
+                video_tile_block((x / VIDEO_TILE_SIZE), (y / VIDEO_TILE_SIZE), TILE_BRICK, TILE_BRICK_COLS, TILE_BRICK_ROWS);
+        }
 
-    video_bit_blit((x - (SPRITE_BALL_COLS / 2)), (y - (SPRITE_BALL_ROWS / 2)), &a_bit_map);
+        wall_draw_row++;
+    }
+#else
+    if ( wall_draw_row < wall.rows )
+    {
+        video_fill_wait();
+
+        a_bit_map.col_count = SPRITE_BRICK_COLS;
+        a_bit_map.row_count = SPRITE_BRICK_ROWS;
+        a_bit_map.bitmap = sprite_brick;
+
+        for ( col = 0; col < wall.cols; col++ )
+        {
+            if ( bricks_test(&wall, col, wall_draw_row) )
+                video_bit_blit(wall.x0 + (col << BRICK_COL_SHIFT), wall.y0 + (wall_draw_row << BRICK_ROW_SHIFT), &a_bit_map);
+        }
+
+        wall_draw_row++;
+    }
+#endif
+}
+#endif
+
+/* ----------------------------------------------------------------------------
+ * ponggame_draw_paddle()
+ *
+ *  Move paddle sprite given paddle center point
+ *
+ *  Param:  Paddle center point coordinates
+ *  return: none
+ * 
+ */
+static void ponggame_draw_paddle(int x, int y)
+{
+    if ( y < (SPRITE_PADDLE_LENGTH / 2) )
+        y = SPRITE_PADDLE_LENGTH / 2;
+    else if ( y > (max_y_res - SPRITE_PADDLE_LENGTH) )
+        y = max_y_res - SPRITE_PADDLE_LENGTH + 8;
+
+    video_sprite_move(PADDLE_SPRITE, (x - SPRITE_PADDLE_CENTER), (y - SPRITE_PADDLE_LENGTH / 2));
 }
 
 /* ----------------------------------------------------------------------------
  * ponggame_draw_score()
  *
- *  Draw score on game board
+ *  Draw score on the dynamic plane when it changes.
+ *  The score rows are cleared and the score drawn again,
+ *  the static game board under it is not touched.
+ *  With VIDEO_TILE_MAP the score is digit tiles in the tile
+ *  map, on the cells nearest to its position.
  *
  *  Param:  Score
  *  return: none
@@ -409,14 +651,24 @@ static void ponggame_draw_ball(int x, int y)
  */
 static void ponggame_draw_score(int score)
 {
-    static int  previous_score = 0;
+    static int  previous_score = -1;
 
     if ( score == previous_score )
         return;
 
-    ponggame_render_score(SCORE_X_POS, SCORE_Y_POS, previous_score);
     previous_score = score;
-    ponggame_render_score(SCORE_X_POS, SCORE_Y_POS, score);
+
+#if (VIDEO_TILE_MAP == 1)
+    video_tile_fill((BORDER_X / VIDEO_TILE_SIZE), (SCORE_Y_POS / VIDEO_TILE_SIZE),
+                    ((max_x_res + 1 - BORDER_X) / VIDEO_TILE_SIZE), TILE_NUMBERS_ROWS, 0);
+    ponggame_render_score(score_x_pos, SCORE_Y_POS, score);
+#else
+    video_set_plane(VIDEO_PLANE_DYNAMIC);
+    video_fill_rect(0, SCORE_Y_POS, max_x_res, (SCORE_Y_POS + SPRITE_NUMBERS_ROWS - 1), SCREEN_BACKGROUND, 0);
+    video_fill_wait();
+    ponggame_render_score(score_x_pos, SCORE_Y_POS, score);
+    video_set_plane(VIDEO_PLANE_STATIC);
+#endif
 }
 
 /* ----------------------------------------------------------------------------
@@ -446,8 +698,14 @@ static void ponggame_render_score(uint32_t x, uint32_t y, int score)
         score_digit = score_temp - (score_div_ten * 10);
         score_temp = score_div_ten;
 
+#if (VIDEO_TILE_MAP == 1)
+        video_tile_block(((x / VIDEO_TILE_SIZE) - (digit_index * TILE_NUMBERS_COLS)), (y / VIDEO_TILE_SIZE),
+                         (TILE_NUMBERS + (score_digit * TILE_NUMBERS_COLS * TILE_NUMBERS_ROWS)),
+                         TILE_NUMBERS_COLS, TILE_NUMBERS_ROWS);
+#else
         a_bit_map.bitmap = &sprite_numbers[(score_digit * SPRITE_NUMBERS_ROWS)];
         video_bit_blit(x - (digit_index * SPRITE_NUMBERS_COLS), y, &a_bit_map);
+#endif
 
         digit_index++;
     }
@@ -0,0 +1,403 @@
+/* runs.c
+ *
+ * Sparse frame buffer rows of white pixel runs
+ *
+ * A row is a list of the runs of white pixels in it, sorted left to right,
+ * that neither overlap nor touch. Runs are taken from a fixed pool of
+ * VIDEO_RUNS and returned to it when they are cleared, so memory use and
+ * the cost of clearing follow what is drawn, not the screen resolution.
+ * Drawing is done with spans that set, clear or flip a range of pixels in
+ * a row, and a row is expanded into the pixel words of a scan line at scanout.
+ *
+ * The scan line interrupt walks the lists while they are changed. A run is
+ * filled in before it is linked into a row, and unlinked before it is
+ * returned to the pool, so a row is a well formed list after every store.
+ *
+ */
+
+#include    "pico.h"
+
+#include    "scanline.h"
+#include    "runs.h"
+
+/* ----------------------------------------------------------------------------
+ * Module definitions
+ */
+#define     PIXEL_FIELD_MASK    0xffff0000
+#define     RUN_NONE            0xffff      // End of a list
+
+_Static_assert(VIDEO_RUNS > 0 && VIDEO_RUNS < RUN_NONE, "VIDEO_RUNS must fit a 16 bit run index");
+
+typedef struct
+{
+    uint16_t    start;          // First pixel
+    uint16_t    end;            // Pixel after the last
+    uint16_t    next;           // Next run to the right, or RUN_NONE
+} run_t;
+
+/* ----------------------------------------------------------------------------
+ * Function prototypes
+ */
+static uint16_t runs_alloc(uint32_t start, uint32_t end, uint16_t next);
+static void     runs_free(uint16_t *link);
+static int      runs_set(uint16_t *head, uint32_t x0, uint32_t x1);
+static int      runs_reset(uint16_t *head, uint32_t x0, uint32_t x1);
+static int      runs_flip(uint16_t *head, uint32_t x0, uint32_t x1);
+
+/* ----------------------------------------------------------------------------
+ * Module globals
+ */
+static run_t            runs[VIDEO_RUNS];
+static uint16_t         row_head[VIDEO_Y_RESOLUTION];
+static uint16_t         free_head = RUN_NONE;
+static runs_stats_t     stats;
+
+/***************************************************************
+ * runs_init()
+ *
+ *  Empty all rows and return all runs to the pool.
+ *
+ *  Param:  none
+ *  return: none
+ *
+ */
+void runs_init(void)
+{
+    for ( int i = 0; i < VIDEO_RUNS; i++ )
+        runs[i].next = (i + 1 < VIDEO_RUNS) ? (i + 1) : RUN_NONE;
+
+    for ( int i = 0; i < VIDEO_Y_RESOLUTION; i++ )
+        row_head[i] = RUN_NONE;
+
+    free_head = 0;
+
+    stats.used = 0;
+    stats.max_used = 0;
+    stats.drops = 0;
+}
+
+/***************************************************************
+ * runs_span()
+ *
+ *  Set, clear or flip the pixels [x0, x1) of a row.
+ *  A span that needs more runs than are left in the pool
+ *  is drawn in part, and counted as dropped.
+ *
+ *  Param:  Row, first pixel and pixel after the last (clipped to the screen), action
+ *  return: 0 if drawn, -1 if the pool ran out
+ *
+ */
+int __not_in_flash_func(runs_span)(uint32_t row, uint32_t x0, uint32_t x1, pixel_action_t action)
+{
+    int     result;
+
+    if ( x1 > VIDEO_X_RESOLUTION )
+        x1 = VIDEO_X_RESOLUTION;
+
+    if ( row >= VIDEO_Y_RESOLUTION || x0 >= x1 )
+        return 0;
+
+    if ( action == CLEAR )
+        result = runs_reset(&row_head[row], x0, x1);
+    else if ( action == SET )
+        result = runs_set(&row_head[row], x0, x1);
+    else
+        result = runs_flip(&row_head[row], x0, x1);
+
+    if ( result )
+        stats.drops++;
+
+    return result;
+}
+
+/***************************************************************
+ * runs_clear_row()
+ *
+ *  Clear a row, returning its runs to the pool.
+ *
+ *  Param:  Row
+ *  return: none
+ *
+ */
+void __not_in_flash_func(runs_clear_row)(uint32_t row)
+{
+    if ( row >= VIDEO_Y_RESOLUTION )
+        return;
+
+    while ( row_head[row] != RUN_NONE )
+        runs_free(&row_head[row]);
+}
+
+/***************************************************************
+ * runs_clear()
+ *
+ *  Clear all rows.
+ *
+ *  Param:  none
+ *  return: none
+ *
+ */
+void __not_in_flash_func(runs_clear)(void)
+{
+    for ( uint32_t row = 0; row < VIDEO_Y_RESOLUTION && stats.used; row++ )
+        runs_clear_row(row);
+}
+
+/***************************************************************
+ * runs_row_used()
+ *
+ *  Check if a row has white pixels.
+ *
+ *  Param:  Row
+ *  return: True if the row has runs
+ *
+ */
+int __not_in_flash_func(runs_row_used)(uint32_t row)
+{
+    return (row < VIDEO_Y_RESOLUTION && row_head[row] != RUN_NONE);
+}
+
+/***************************************************************
+ * runs_expand()
+ *
+ *  OR the runs of a row into the pixel fields of a scan line.
+ *  A run costs a masked word at either end and a store per
+ *  16 pixels between them.
+ *
+ *  Param:  Row, scan line of SCAN_LINE_BUF_LEN words
+ *  return: none
+ *
+ */
+void __not_in_flash_func(runs_expand)(uint32_t row, uint32_t *line)
+{
+    uint32_t   *pixels = &line[ACTIVE_VIDEO_OFFSET];
+    uint32_t    first, last, stop;
+
+    if ( row >= VIDEO_Y_RESOLUTION )
+        return;
+
+    for ( uint16_t n = row_head[row]; n != RUN_NONE; n = runs[n].next )
+    {
+        first = runs[n].start;
+        last = runs[n].end;
+
+        if ( first & 0x0f )
+        {
+            stop = (last < ((first | 0x0f) + 1)) ? (last & 0x0f) : 16;
+            pixels[first >> 4] |= (PIXEL_FIELD_MASK >> (first & 0x0f)) & ~(PIXEL_FIELD_MASK >> stop);
+            first = (first & ~0x0f) + stop;
+        }
+
+        for ( ; (first + 16) <= last; first += 16 )
+            pixels[first >> 4] |= PIXEL_FIELD_MASK;
+
+        if ( first < last )
+            pixels[first >> 4] |= PIXEL_FIELD_MASK & ~(PIXEL_FIELD_MASK >> (last - first));
+    }
+}
+
+/***************************************************************
+ * runs_get_stats()
+ *
+ *  Return run pool statistics. The most runs used and
+ *  the drop count are reset by the call.
+ *
+ *  Param:  Pointer to statistics
+ *  return: none
+ *
+ */
+void runs_get_stats(runs_stats_t *run_stats)
+{
+    *run_stats = stats;
+
+    stats.max_used = stats.used;
+    stats.drops = 0;
+}
+
+/* ----------------------------------------------------------------------------
+ * runs_alloc()
+ *
+ *  Take a run from the pool.
+ *
+ *  Param:  First pixel, pixel after the last, next run
+ *  return: Run index, RUN_NONE if the pool is empty
+ *
+ */
+static uint16_t __not_in_flash_func(runs_alloc)(uint32_t start, uint32_t end, uint16_t next)
+{
+    uint16_t    n = free_head;
+
+    if ( n == RUN_NONE )
+        return RUN_NONE;
+
+    free_head = runs[n].next;
+
+    runs[n].start = start;
+    runs[n].end = end;
+    runs[n].next = next;
+
+    if ( ++stats.used > stats.max_used )
+        stats.max_used = stats.used;
+
+    return n;
+}
+
+/* ----------------------------------------------------------------------------
+ * runs_free()
+ *
+ *  Unlink a run from its row and return it to the pool.
+ *
+ *  Param:  Link to the run, a row head or the previous run's next
+ *  return: none
+ *
+ */
+static void __not_in_flash_func(runs_free)(uint16_t *link)
+{
+    uint16_t    n = *link;
+
+    *link = runs[n].next;
+
+    runs[n].next = free_head;
+    free_head = n;
+
+    stats.used--;
+}
+
+/* ----------------------------------------------------------------------------
+ * runs_set()
+ *
+ *  Set the pixels [x0, x1) of a row. The span is merged with
+ *  the runs it overlaps or touches, or added as a new run.
+ *
+ *  Param:  Row head, first pixel and pixel after the last
+ *  return: 0 if drawn, -1 if the pool is empty
+ *
+ */
+static int __not_in_flash_func(runs_set)(uint16_t *head, uint32_t x0, uint32_t x1)
+{
+    uint16_t   *link = head;
+    uint16_t    n, m;
+
+    while ( *link != RUN_NONE && runs[*link].end < x0 )
+        link = &runs[*link].next;
+
+    n = *link;
+
+    if ( n == RUN_NONE || runs[n].start > x1 )
+    {
+        n = runs_alloc(x0, x1, n);
+        if ( n == RUN_NONE )
+            return -1;
+
+        *link = n;
+        return 0;
+    }
+
+    /* Grow the first run over the span and the runs it reaches,
+     * then drop those runs
+     */
+    for ( m = runs[n].next; m != RUN_NONE && runs[m].start <= x1; m = runs[m].next )
+    {
+        if ( runs[m].end > x1 )
+            x1 = runs[m].end;
+    }
+
+    if ( x0 < runs[n].start )
+        runs[n].start = x0;
+    if ( x1 > runs[n].end )
+        runs[n].end = x1;
+
+    while ( runs[n].next != m )
+        runs_free(&runs[n].next);
+
+    return 0;
+}
+
+/* ----------------------------------------------------------------------------
+ * runs_reset()
+ *
+ *  Clear the pixels [x0, x1) of a row. Runs in the span are dropped
+ *  and runs across its ends are cut, a run across both ends is split.
+ *
+ *  Param:  Row head, first pixel and pixel after the last
+ *  return: 0 if cleared, -1 if a split needed a run and the pool is empty
+ *
+ */
+static int __not_in_flash_func(runs_reset)(uint16_t *head, uint32_t x0, uint32_t x1)
+{
+    uint16_t   *link = head;
+    uint16_t    n, m;
+
+    while ( *link != RUN_NONE && runs[*link].end <= x0 )
+        link = &runs[*link].next;
+
+    while ( (n = *link) != RUN_NONE && runs[n].start < x1 )
+    {
+        if ( runs[n].start < x0 )
+        {
+            if ( runs[n].end > x1 )
+            {
+                m = runs_alloc(x1, runs[n].end, runs[n].next);
+                if ( m == RUN_NONE )
+                    return -1;
+
+                runs[n].next = m;
+                runs[n].end = x0;
+                return 0;
+            }
+
+            runs[n].end = x0;
+            link = &runs[n].next;
+        }
+        else if ( runs[n].end > x1 )
+        {
+            runs[n].start = x1;
+            return 0;
+        }
+        else
+            runs_free(link);
+    }
+
+    return 0;
+}
+
+/* ----------------------------------------------------------------------------
+ * runs_flip()
+ *
+ *  Flip the pixels [x0, x1) of a row, left to right: the part of
+ *  a run in the span is cleared, and a gap between runs is set.
+ *
+ *  Param:  Row head, first pixel and pixel after the last
+ *  return: 0 if flipped, -1 if the pool ran out
+ *
+ */
+static int __not_in_flash_func(runs_flip)(uint16_t *head, uint32_t x0, uint32_t x1)
+{
+    uint16_t    n;
+    uint32_t    stop;
+    int         result;
+
+    while ( x0 < x1 )
+    {
+        for ( n = *head; n != RUN_NONE && runs[n].end <= x0; n = runs[n].next )
+            ;
+
+        if ( n != RUN_NONE && runs[n].start <= x0 )
+        {
+            stop = (runs[n].end < x1) ? runs[n].end : x1;
+            result = runs_reset(head, x0, stop);
+        }
+        else
+        {
+            stop = (n != RUN_NONE && runs[n].start < x1) ? runs[n].start : x1;
+            result = runs_set(head, x0, stop);
+        }
+
+        if ( result )
+            return result;
+
+        x0 = stop;
+    }
+
+    return 0;
+}
@@ -0,0 +1,235 @@
+/* scanline.c
+ *
+ * Video scan line and sync table generation
+ *
+ * Sync pulses are low going on the video output, they are '1' bits
+ * in the sync (low) 16 bit field of the scan line words. HSTX shifts
+ * each field out MSB first, so bit time 't' within a word is bit (15 - t).
+ *
+ */
+
+#include    <string.h>
+
+#include    "pico.h"
+
+#include    "scanline.h"
+
+/* ----------------------------------------------------------------------------
+ * Module definitions
+ */
+#define     SYNC_FIELD_MASK     0x0000ffff
+#define     MIN_REPEAT          3           // Shortest run of equal words sent with a repeat command
+
+/* With the expander the DMA reads the command lists, and the tables
+ * are only read at initialization. Without it, the DMA reads the tables.
+ */
+#if (VIDEO_HSTX_EXPAND == 1)
+#define     SYNC_TABLE_SECTION
+#else
+#define     SYNC_TABLE_SECTION  __scratch_x("scanline")
+#endif
+
+/* ----------------------------------------------------------------------------
+ * Function prototypes
+ */
+static void scanline_sync_pulse(uint32_t *line, int words, int start, int end);
+static void scanline_line(vid_line_t *sync_line, const uint32_t *table, int words);
+
+/* ----------------------------------------------------------------------------
+ * Module globals
+ *
+ * What scanout DMA reads during blanking is in the scratch X bank
+ * (core 1 is not used), so it does not touch the main SRAM banks
+ * the CPU draws into.
+ */
+uint32_t SYNC_TABLE_SECTION vid_blank_scan_line[SCAN_LINE_BUF_LEN];
+uint32_t SYNC_TABLE_SECTION vid_blank_half_scan_line[HALF_SCAN_LINE_BUF_LEN];
+uint32_t SYNC_TABLE_SECTION vid_equalizing_pulse[EQ_PULSE_BUF_LEN];
+uint32_t SYNC_TABLE_SECTION vid_vert_sync[SCAN_LINE_BUF_LEN];
+
+vid_line_t  vid_blank_line;
+vid_line_t  vid_blank_half_line;
+vid_line_t  vid_equalizing_line;
+vid_line_t  vid_equalizing_long_line;
+vid_line_t  vid_vert_sync_line;
+vid_line_t  vid_blank_word_line;
+
+#if (VIDEO_HSTX_EXPAND == 1)
+static uint32_t __scratch_x("scanline") command_pool[VID_CMD_POOL_LEN];
+static int      command_pool_used = 0;
+#endif
+
+/***************************************************************
+ * scanline_init()
+ *
+ *  Generate the sync scan line tables from the video standard timing.
+ *  Call before starting video DMA.
+ *
+ *  Param:  none
+ *  return: none
+ *
+ */
+void scanline_init(void)
+{
+    int     half_line = HALF_LINE_WORDS * VID_WORD_BITS;
+
+    memset(vid_blank_scan_line, 0, sizeof(vid_blank_scan_line));
+    memset(vid_blank_half_scan_line, 0, sizeof(vid_blank_half_scan_line));
+    memset(vid_equalizing_pulse, 0, sizeof(vid_equalizing_pulse));
+    memset(vid_vert_sync, 0, sizeof(vid_vert_sync));
+
+    /* Blank scan line, horizontal sync after the front porch
+     */
+    scanline_sync_pulse(vid_blank_scan_line, SCAN_LINE_BUF_LEN,
+                        VID_FRONT_PORCH_BITS, VID_FRONT_PORCH_BITS + VID_SYNC_BITS);
+
+    scanline_sync_pulse(vid_blank_half_scan_line, HALF_SCAN_LINE_BUF_LEN,
+                        VID_FRONT_PORCH_BITS, VID_FRONT_PORCH_BITS + VID_SYNC_BITS);
+
+    /* Two equalizing pulses per scan line.
+     * The half line extension in an even field stays blank.
+     */
+    scanline_sync_pulse(vid_equalizing_pulse, EQ_PULSE_BUF_LEN,
+                        VID_FRONT_PORCH_BITS, VID_FRONT_PORCH_BITS + VID_EQ_PULSE_BITS);
+    scanline_sync_pulse(vid_equalizing_pulse, EQ_PULSE_BUF_LEN,
+                        half_line + VID_FRONT_PORCH_BITS, half_line + VID_FRONT_PORCH_BITS + VID_EQ_PULSE_BITS);
+
+    /* Two broad (vertical sync) pulses per scan line,
+     * separated by serration gaps
+     */
+    scanline_sync_pulse(vid_vert_sync, SCAN_LINE_BUF_LEN,
+                        VID_FRONT_PORCH_BITS, VID_FRONT_PORCH_BITS + VID_BROAD_PULSE_BITS);
+    scanline_sync_pulse(vid_vert_sync, SCAN_LINE_BUF_LEN,
+                        half_line + VID_FRONT_PORCH_BITS, half_line + VID_FRONT_PORCH_BITS + VID_BROAD_PULSE_BITS);
+
+    /* What is sent for each sync and blank line
+     */
+#if (VIDEO_HSTX_EXPAND == 1)
+    command_pool_used = 0;
+#endif
+
+    scanline_line(&vid_blank_line, vid_blank_scan_line, SCAN_LINE_BUF_LEN);
+    scanline_line(&vid_blank_half_line, vid_blank_half_scan_line, HALF_SCAN_LINE_BUF_LEN);
+    scanline_line(&vid_equalizing_line, vid_equalizing_pulse, SCAN_LINE_BUF_LEN);
+    scanline_line(&vid_equalizing_long_line, vid_equalizing_pulse, EQ_PULSE_BUF_LEN);
+    scanline_line(&vid_vert_sync_line, vid_vert_sync, SCAN_LINE_BUF_LEN);
+    scanline_line(&vid_blank_word_line, vid_blank_scan_line, 1);
+}
+
+/***************************************************************
+ * scanline_active_init()
+ *
+ *  Set up the words around the active video of a scan line buffer:
+ *  the horizontal sync, and with the expander its commands.
+ *  Call scanline_init() first.
+ *
+ *  Param:  Scan line buffer of SCAN_LINE_BUF_LEN words
+ *  return: none
+ *
+ */
+void scanline_active_init(uint32_t *line)
+{
+    memcpy(line, vid_blank_scan_line, (ACTIVE_VIDEO_OFFSET * sizeof(uint32_t)));
+
+#if (VIDEO_HSTX_EXPAND == 1)
+    line[0] = VID_CMD_RAW | (SCAN_LINE_BUF_LEN - VID_TRAILING_WORDS - 1);
+    line[SCAN_LINE_BUF_LEN - VID_TRAILING_WORDS] = VID_CMD_RAW_REPEAT | (VID_TRAILING_WORDS + 1);
+    line[SCAN_LINE_BUF_LEN - VID_TRAILING_WORDS + 1] = 0;
+#endif
+}
+
+/* ----------------------------------------------------------------------------
+ * scanline_sync_pulse()
+ *
+ *  Set sync bits for a pulse in a scan line table
+ *
+ *  Param:  Scan line table and its length in words,
+ *          pulse start and end (exclusive) in bit times from the start of the line
+ *  return: none
+ *
+ */
+static void scanline_sync_pulse(uint32_t *line, int words, int start, int end)
+{
+    int     first, last;
+
+    for ( int i = 0; i < words; i++ )
+    {
+        first = start - (i * VID_WORD_BITS);
+        last = end - (i * VID_WORD_BITS);
+
+        if ( last <= 0 || first >= VID_WORD_BITS )
+            continue;
+
+        if ( first < 0 )
+            first = 0;
+        if ( last > VID_WORD_BITS )
+            last = VID_WORD_BITS;
+
+        line[i] |= (SYNC_FIELD_MASK >> first) & ~(SYNC_FIELD_MASK >> last);
+    }
+}
+
+/* ----------------------------------------------------------------------------
+ * scanline_line()
+ *
+ *  Set up what is sent for a sync or blank scan line.
+ *  With the expander, the table is encoded into the command pool, from its
+ *  second word with its first word last: runs of MIN_REPEAT or more equal
+ *  words as a RAW_REPEAT command, other words in RAW commands.
+ *  Without it, the table is sent as it is.
+ *  A command list that does not fit in the pool is cut short, tools/hstx_model.c
+ *  checks that they fit with the build options.
+ *
+ *  Param:  Line to set up, its table and length in words
+ *  return: none
+ *
+ */
+static void scanline_line(vid_line_t *sync_line, const uint32_t *table, int words)
+{
+#if (VIDEO_HSTX_EXPAND == 1)
+    uint32_t   *commands = &command_pool[command_pool_used];
+    uint32_t   *raw_command = 0;
+    int         room = VID_CMD_POOL_LEN - command_pool_used;
+    int         count = 0;
+    int         run;
+
+    for ( int i = 0; i < words; i += run )
+    {
+        for ( run = 1; (i + run) < words && table[(i + run + 1) % words] == table[(i + 1) % words]; run++ )
+            ;
+
+        if ( run >= MIN_REPEAT )
+        {
+            if ( (count + 2) > room )
+                break;
+
+            commands[count++] = VID_CMD_RAW_REPEAT | run;
+            commands[count++] = table[(i + 1) % words];
+            raw_command = 0;
+        }
+        else
+        {
+            if ( (count + run + 1) > room )
+                break;
+
+            if ( !raw_command )
+            {
+                raw_command = &commands[count++];
+                *raw_command = VID_CMD_RAW;
+            }
+
+            for ( int j = 0; j < run; j++ )
+                commands[count++] = table[(i + j + 1) % words];
+
+            *raw_command += run;
+        }
+    }
+
+    sync_line->words = commands;
+    sync_line->count = count;
+    command_pool_used += count;
+#else
+    sync_line->words = table;
+    sync_line->count = words;
+#endif
+}
@@ -0,0 +1,204 @@
+/* sched.c
+ *
+ * Vertical blanking task scheduler
+ *
+ * Modules register tasks that run once per game tick (or every 'period' ticks)
+ * in the vertical blanking window, from the start of vertical retrace to
+ * the first active scan line. Tasks run in priority order:
+ * - Critical tasks always run when due, they keep game and audio time.
+ * - Other tasks run only if their cycle budget fits in what is left of the window,
+ *   otherwise they are deferred and stay due for the next window.
+ * - Background tasks run after the blanking window, and must complete
+ *   before the next vertical retrace.
+ * A task that completes after its window closed counts a deadline miss,
+ * and a task that runs longer than its budget counts an overrun.
+ *
+ */
+
+#include    <stdio.h>
+
+#include    "hardware/clocks.h"
+
+#include    "sched.h"
+#include    "trace.h"
+#include    "io.h"
+
+/* ----------------------------------------------------------------------------
+ * Module definitions
+ */
+
+/* ----------------------------------------------------------------------------
+ * Function prototypes
+ */
+static void sched_run_task(sched_task_t *task, uint32_t tick, uint32_t deadline);
+
+/* ----------------------------------------------------------------------------
+ * Module globals
+ */
+static sched_task_t    *tasks[SCHED_TASKS_MAX];
+static int              task_count = 0;
+static int              task_ids = 0;
+static uint32_t         cycles_per_usec;
+static uint32_t         field_cycles;
+
+/***************************************************************
+ * sched_init()
+ *
+ *  Initialize the scheduler, call after io_init()
+ *
+ *  Param:  none
+ *  return: none
+ *
+ */
+void sched_init(void)
+{
+    task_count = 0;
+    task_ids = 0;
+    cycles_per_usec = clock_get_hz(clk_sys) / 1000000;
+    field_cycles = clock_get_hz(clk_sys) / TICK_RATE;
+}
+
+/***************************************************************
+ * sched_add()
+ *
+ *  Register a task. Tasks of equal priority run in
+ *  the order they were added.
+ *
+ *  Param:  Task, must remain valid while the scheduler runs
+ *  return: 0 if added, -1 if the task table is full
+ *
+ */
+int sched_add(sched_task_t *task)
+{
+    int     i;
+
+    if ( task_count == SCHED_TASKS_MAX )
+        return -1;
+
+    task->id = task_ids++;
+    task->budget = task->budget_us * cycles_per_usec;
+    task->due = io_get_tick_count() + (task->period ? task->period : 1);
+    task->runs = 0;
+    task->deferrals = 0;
+    task->overruns = 0;
+    task->misses = 0;
+    task->max_cycles = 0;
+
+    for ( i = task_count; i > 0 && tasks[i - 1]->priority < task->priority; i-- )
+        tasks[i] = tasks[i - 1];
+
+    tasks[i] = task;
+    task_count++;
+
+#if (TRACE == 1)
+    trace_name(task->id, task->name);
+#endif
+
+    return 0;
+}
+
+/***************************************************************
+ * sched_run()
+ *
+ *  Run due tasks for the current vertical blanking window.
+ *  Call once per tick, after io_wait_vsync().
+ *
+ *  Param:  none
+ *  return: none
+ *
+ */
+void sched_run(void)
+{
+    uint32_t    tick;
+    uint32_t    vsync;
+    uint32_t    deadline;
+    int         i;
+
+    tick = io_get_tick_count();
+    vsync = io_get_vsync_cycles();
+
+    /* Blanking window tasks
+     */
+    deadline = vsync + io_get_vblank_cycles();
+
+    for ( i = 0; i < task_count && tasks[i]->priority > SCHED_PRIO_BACKGROUND; i++ )
+        sched_run_task(tasks[i], tick, deadline);
+
+    /* Background tasks, until the next vertical retrace
+     */
+    deadline = vsync + field_cycles;
+
+    for ( ; i < task_count; i++ )
+        sched_run_task(tasks[i], tick, deadline);
+
+    TRACE_EVENT(TRACE_FRAME, 0, io_get_cycles() - vsync);
+}
+
+/***************************************************************
+ * sched_print_stats()
+ *
+ *  Print task run statistics
+ *
+ *  Param:  none
+ *  return: none
+ *
+ */
+void sched_print_stats(void)
+{
+    for ( int i = 0; i < task_count; i++ )
+    {
+        printf("task %-10s runs %u defer %u over %u miss %u max %uus\n",
+               tasks[i]->name,
+               (unsigned int)tasks[i]->runs,
+               (unsigned int)tasks[i]->deferrals,
+               (unsigned int)tasks[i]->overruns,
+               (unsigned int)tasks[i]->misses,
+               (unsigned int)(tasks[i]->max_cycles / cycles_per_usec));
+    }
+}
+
+/* ----------------------------------------------------------------------------
+ * sched_run_task()
+ *
+ *  Run a task if it is due and fits in the window,
+ *  and update its statistics.
+ *
+ *  Param:  Task, current tick count, and window deadline in CPU cycles
+ *  return: none
+ *
+ */
+static void sched_run_task(sched_task_t *task, uint32_t tick, uint32_t deadline)
+{
+    uint32_t    start;
+    uint32_t    cycles;
+
+    if ( (int32_t)(tick - task->due) < 0 )
+        return;
+
+    start = io_get_cycles();
+
+    if ( task->priority != SCHED_PRIO_CRITICAL &&
+         (int32_t)(deadline - start) < (int32_t)task->budget )
+    {
+        task->deferrals++;
+        return;
+    }
+
+    task->func();
+
+    cycles = io_get_cycles() - start;
+
+    TRACE_EVENT(TRACE_TASK, task->id, cycles);
+
+    task->runs++;
+    task->due = tick + (task->period ? task->period : 1);
+
+    if ( cycles > task->max_cycles )
+        task->max_cycles = cycles;
+
+    if ( cycles > task->budget )
+        task->overruns++;
+
+    if ( (int32_t)(start + cycles - deadline) > 0 )
+        task->misses++;
+}
@@ -0,0 +1,355 @@
+/* serial.c
+ *
+ * Non-blocking UART transmit queue
+ *
+ * Writers copy data into a RAM ring buffer and return, a DMA channel
+ * drains the ring into the stdio UART TX FIFO. When a DMA transfer completes
+ * its interrupt starts the next one, up to the end of the ring or the end
+ * of the queued data, so the UART is kept busy without CPU polling.
+ * A write that does not fit in the ring is dropped whole and counted,
+ * so a writer never waits for the UART. Writes may come from any context,
+ * the ring is updated with interrupts disabled.
+ *
+ * The module is also the stdio output driver, in place of the SDK's UART
+ * driver that waits for room in the UART FIFO. printf() formats into
+ * the ring and returns, so a print costs the formatting and a copy and
+ * can be left in a game task or an interrupt handler. When the ring is
+ * full the rest of the line is dropped and the dropped lines are counted.
+ *
+ * Binary data is sent in packets that a host tool can find among text prints:
+ * sync byte, type, 16 bit little endian payload length, payload, and a checksum
+ * that is the 8 bit sum of the type, length and payload bytes.
+ *
+ */
+
+#include    <string.h>
+
+#include    "pico/stdlib.h"
+#include    "pico/stdio/driver.h"
+#include    "pico/stdio_uart.h"
+#include    "hardware/dma.h"
+#include    "hardware/irq.h"
+#include    "hardware/sync.h"
+#include    "hardware/uart.h"
+
+#include    "serial.h"
+#include    "io.h"
+
+/* ----------------------------------------------------------------------------
+ * Module definitions
+ */
+#define     SERIAL_BUF_MASK         (SERIAL_TX_BUF_SIZE - 1)
+
+/* ----------------------------------------------------------------------------
+ * Function prototypes
+ */
+static void serial_copy(const void *data, uint32_t len);
+static void serial_start(void);
+static void serial_dma_irq_handler(void);
+static void serial_stdio_out_chars(const char *buf, int len);
+static int  serial_stdio_in_chars(char *buf, int len);
+
+/* ----------------------------------------------------------------------------
+ * Module globals
+ */
+static uint8_t              tx_buf[SERIAL_TX_BUF_SIZE];
+static volatile uint32_t    head = 0;               // Free running write index
+static volatile uint32_t    tail = 0;               // Free running index of the next byte to send
+static volatile uint32_t    dma_count = 0;          // Bytes in the running DMA transfer
+static serial_stats_t       stats;
+static int                  line_dropped = 0;       // Dropping the rest of a stdio line
+
+static stdio_driver_t       serial_stdio =
+{
+    .out_chars = serial_stdio_out_chars,
+    .in_chars = serial_stdio_in_chars,
+#if PICO_STDIO_ENABLE_CRLF_SUPPORT
+    .crlf_enabled = PICO_STDIO_DEFAULT_CRLF,
+#endif
+};
+
+/***************************************************************
+ * serial_init()
+ *
+ *  Set up the transmit DMA channel on the stdio UART,
+ *  and replace the SDK's stdio UART driver.
+ *  Call after io_init() and before the first print: the queue must
+ *  be the only writer of the UART data register, a blocking write
+ *  while a DMA transfer runs would interleave bytes with it.
+ *
+ *  Param:  none
+ *  return: none
+ *
+ */
+void serial_init(void)
+{
+    dma_channel_config  c;
+
+    memset(&stats, 0, sizeof(stats));
+
+    dma_channel_claim(SERIAL_DMA_CHAN);
+
+    c = dma_channel_get_default_config(SERIAL_DMA_CHAN);
+    channel_config_set_dreq(&c, uart_get_dreq(uart_default, true));
+    channel_config_set_read_increment(&c, true);
+    channel_config_set_write_increment(&c, false);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_8);
+    dma_channel_configure(SERIAL_DMA_CHAN, &c, &uart_get_hw(uart_default)->dr, tx_buf, 0, false);
+
+    irq_set_exclusive_handler(SERIAL_DMA_IRQ, serial_dma_irq_handler);
+    irq_set_enabled(SERIAL_DMA_IRQ, true);
+
+    dma_irqn_set_channel_enabled((SERIAL_DMA_IRQ - DMA_IRQ_0), SERIAL_DMA_CHAN, true);
+
+    stdio_set_driver_enabled(&stdio_uart, false);
+    stdio_set_driver_enabled(&serial_stdio, true);
+}
+
+/***************************************************************
+ * serial_write()
+ *
+ *  Queue data for transmit. The data is copied, the call does not wait.
+ *
+ *  Param:  Data and its length in bytes
+ *  return: Bytes queued, 0 if the data did not fit and was dropped
+ *
+ */
+int __not_in_flash_func(serial_write)(const void *data, uint32_t len)
+{
+    uint32_t    irq_status;
+
+    if ( len == 0 )
+        return 0;
+
+    irq_status = save_and_disable_interrupts();
+
+    if ( (SERIAL_TX_BUF_SIZE - (head - tail)) < len )
+    {
+        stats.drops++;
+        restore_interrupts(irq_status);
+        return 0;
+    }
+
+    serial_copy(data, len);
+
+    if ( dma_count == 0 )
+        serial_start();
+
+    restore_interrupts(irq_status);
+
+    return len;
+}
+
+/***************************************************************
+ * serial_write_packet()
+ *
+ *  Queue a binary packet for transmit. The packet is queued whole
+ *  or dropped, it is never split by other writes.
+ *
+ *  Param:  Packet type, payload and its length (up to SERIAL_PACKET_MAX)
+ *  return: Bytes queued, 0 if the packet did not fit and was dropped
+ *
+ */
+int __not_in_flash_func(serial_write_packet)(uint8_t type, const void *payload, uint32_t len)
+{
+    uint8_t     header[SERIAL_PACKET_HEADER];
+    uint8_t     sum;
+    uint32_t    irq_status;
+
+    header[0] = SERIAL_PACKET_SYNC;
+    header[1] = type;
+    header[2] = len & 0xff;
+    header[3] = len >> 8;
+
+    sum = header[1] + header[2] + header[3];
+    for ( uint32_t i = 0; i < len; i++ )
+        sum += ((const uint8_t*)payload)[i];
+
+    irq_status = save_and_disable_interrupts();
+
+    if ( len > SERIAL_PACKET_MAX ||
+         (SERIAL_TX_BUF_SIZE - (head - tail)) < (SERIAL_PACKET_HEADER + len + 1) )
+    {
+        stats.drops++;
+        restore_interrupts(irq_status);
+        return 0;
+    }
+
+    serial_copy(header, SERIAL_PACKET_HEADER);
+    serial_copy(payload, len);
+    serial_copy(&sum, 1);
+
+    if ( dma_count == 0 )
+        serial_start();
+
+    restore_interrupts(irq_status);
+
+    return SERIAL_PACKET_HEADER + len + 1;
+}
+
+/***************************************************************
+ * serial_free()
+ *
+ *  Return the free space in the transmit queue
+ *
+ *  Param:  none
+ *  return: Free bytes
+ *
+ */
+uint32_t serial_free(void)
+{
+    return SERIAL_TX_BUF_SIZE - (head - tail);
+}
+
+/***************************************************************
+ * serial_bytes_per_tick()
+ *
+ *  Return the UART throughput in bytes per game tick,
+ *  with 10 bit times per byte (start, 8 data, stop).
+ *
+ *  Param:  none
+ *  return: Bytes per tick
+ *
+ */
+uint32_t serial_bytes_per_tick(void)
+{
+    return PICO_DEFAULT_UART_BAUD_RATE / 10 / TICK_RATE;
+}
+
+/***************************************************************
+ * serial_get_stats()
+ *
+ *  Return transmit queue statistics
+ *
+ *  Param:  Pointer to statistics
+ *  return: none
+ *
+ */
+void serial_get_stats(serial_stats_t *s)
+{
+    *s = stats;
+}
+
+/* ----------------------------------------------------------------------------
+ * serial_stdio_out_chars()
+ *
+ *  stdio output, queue text for transmit. The SDK passes
+ *  a printf() in chunks, so when a chunk is dropped the
+ *  chunks up to the end of its line are dropped too.
+ *
+ *  Param:  Text and its length
+ *  return: none
+ *
+ */
+static void __not_in_flash_func(serial_stdio_out_chars)(const char *buf, int len)
+{
+    if ( len <= 0 )
+        return;
+
+    if ( !line_dropped )
+    {
+        if ( serial_write(buf, len) )
+            return;
+
+        stats.lines_dropped++;
+    }
+
+    line_dropped = (buf[len - 1] != '\n');
+}
+
+/* ----------------------------------------------------------------------------
+ * serial_stdio_in_chars()
+ *
+ *  stdio input, read received characters without waiting
+ *
+ *  Param:  Buffer and its length
+ *  return: Characters read, PICO_ERROR_NO_DATA if none
+ *
+ */
+static int serial_stdio_in_chars(char *buf, int len)
+{
+    int     count = 0;
+
+    while ( count < len && uart_is_readable(uart_default) )
+        buf[count++] = uart_getc(uart_default);
+
+    return count ? count : PICO_ERROR_NO_DATA;
+}
+
+/* ----------------------------------------------------------------------------
+ * serial_copy()
+ *
+ *  Copy data into the ring at the write index, wrapping
+ *  at the end of the ring. Call with interrupts disabled,
+ *  after checking that the data fits.
+ *
+ *  Param:  Data and its length in bytes
+ *  return: none
+ *
+ */
+static void __not_in_flash_func(serial_copy)(const void *data, uint32_t len)
+{
+    uint32_t    index;
+    uint32_t    first;
+    uint32_t    used;
+
+    index = head & SERIAL_BUF_MASK;
+    first = SERIAL_TX_BUF_SIZE - index;
+    if ( first > len )
+        first = len;
+
+    memcpy(&tx_buf[index], data, first);
+    memcpy(tx_buf, (const uint8_t*)data + first, len - first);
+
+    head += len;
+
+    stats.bytes += len;
+    used = head - tail;
+    if ( used > stats.max_used )
+        stats.max_used = used;
+}
+
+/* ----------------------------------------------------------------------------
+ * serial_start()
+ *
+ *  Start a DMA transfer of the queued data, up to the end
+ *  of the ring. Call with interrupts disabled.
+ *
+ *  Param:  none
+ *  return: none
+ *
+ */
+static void __not_in_flash_func(serial_start)(void)
+{
+    uint32_t    index = tail & SERIAL_BUF_MASK;
+    uint32_t    count = head - tail;
+
+    if ( count > (SERIAL_TX_BUF_SIZE - index) )
+        count = SERIAL_TX_BUF_SIZE - index;
+
+    dma_count = count;
+
+    if ( count )
+    {
+        dma_channel_set_read_addr(SERIAL_DMA_CHAN, &tx_buf[index], false);
+        dma_channel_set_trans_count(SERIAL_DMA_CHAN, count, true);
+    }
+}
+
+/* ----------------------------------------------------------------------------
+ * serial_dma_irq_handler()
+ *
+ *  Transmit DMA complete, release the sent bytes
+ *  and start sending what was queued since.
+ *
+ *  Param:  none
+ *  return: none
+ *
+ */
+static void __not_in_flash_func(serial_dma_irq_handler)(void)
+{
+    dma_irqn_acknowledge_channel((SERIAL_DMA_IRQ - DMA_IRQ_0), SERIAL_DMA_CHAN);
+
+    tail += dma_count;
+    serial_start();
+}
@@ -0,0 +1,231 @@
+/* sfx.c
+ *
+ * Tick timed sound effect sequencer
+ *
+ * An effect is a short list of notes, each with a start frequency,
+ * a per-tick pitch sweep and a duration in ticks. Every playing effect
+ * owns one mixer voice. When all voices are busy a new effect steals the
+ * voice of the lowest priority (and then oldest) effect that does not
+ * have a higher priority than itself.
+ * Note timing is taken from the video tick counter, so sfx_tick()
+ * stays in step even if a tick is missed.
+ *
+ */
+
+#include    "sfx.h"
+#include    "audio.h"
+#include    "io.h"
+
+/* ----------------------------------------------------------------------------
+ * Module definitions
+ */
+typedef struct
+{
+    const sfx_t    *effect;         // NULL when the channel is free
+    int             note;
+    uint32_t        note_start;     // Tick count at start of current note
+    uint32_t        started;        // Tick count at start of effect
+} channel_t;
+
+/* ----------------------------------------------------------------------------
+ * Function prototypes
+ */
+static void sfx_start_note(int channel, uint32_t start);
+
+/* ----------------------------------------------------------------------------
+ * Module globals
+ */
+static channel_t    channels[SFX_CHANNELS];
+
+/***************************************************************
+ * sfx_init()
+ *
+ *  Initialize sound effect channels
+ *
+ *  Param:  none
+ *  return: none
+ *
+ */
+void sfx_init(void)
+{
+    for ( int i = 0; i < SFX_CHANNELS; i++ )
+    {
+        channels[i].effect = 0;
+        audio_voice_off(i);
+    }
+}
+
+/***************************************************************
+ * sfx_tick()
+ *
+ *  Advance all playing effects to the current tick count.
+ *  Call once per tick before audio_mix().
+ *
+ *  Param:  none
+ *  return: none
+ *
+ */
+void sfx_tick(void)
+{
+    uint32_t            now;
+    uint32_t            note_end;
+    const sfx_note_t   *note;
+    int32_t             freq;
+
+    now = io_get_tick_count();
+
+    for ( int i = 0; i < SFX_CHANNELS; i++ )
+    {
+        if ( !channels[i].effect )
+            continue;
+
+        note = &channels[i].effect->notes[channels[i].note];
+        note_end = channels[i].note_start + note->ticks;
+
+        while ( (int32_t)(now - note_end) >= 0 )
+        {
+            channels[i].note++;
+            if ( channels[i].note >= channels[i].effect->note_count )
+            {
+                audio_voice_off(i);
+                channels[i].effect = 0;
+                break;
+            }
+
+            sfx_start_note(i, note_end);
+            note = &channels[i].effect->notes[channels[i].note];
+            note_end = channels[i].note_start + note->ticks;
+        }
+
+        if ( !channels[i].effect )
+            continue;
+
+        if ( note->sweep && note->freq != SFX_REST )
+        {
+            freq = note->freq + note->sweep * (int32_t)(now - channels[i].note_start);
+            if ( freq < 1 )
+                freq = 1;
+            audio_voice_set_freq(i, freq);
+        }
+    }
+}
+
+/***************************************************************
+ * sfx_play()
+ *
+ *  Start playing a sound effect. Does not block.
+ *
+ *  Param:  Sound effect
+ *  return: Channel playing the effect, or -1 if all channels
+ *          are busy with higher priority effects
+ *
+ */
+int sfx_play(const sfx_t *effect)
+{
+    int         victim = -1;
+    uint32_t    now;
+
+    if ( !effect || effect->note_count == 0 )
+        return -1;
+
+    now = io_get_tick_count();
+
+    for ( int i = 0; i < SFX_CHANNELS; i++ )
+    {
+        if ( !channels[i].effect )
+        {
+            victim = i;
+            break;
+        }
+    }
+
+    if ( victim < 0 )
+    {
+        for ( int i = 0; i < SFX_CHANNELS; i++ )
+        {
+            if ( channels[i].effect->priority > effect->priority )
+                continue;
+
+            if ( victim < 0 ||
+                 channels[i].effect->priority < channels[victim].effect->priority ||
+                 (channels[i].effect->priority == channels[victim].effect->priority &&
+                  (int32_t)(channels[i].started - channels[victim].started) < 0) )
+            {
+                victim = i;
+            }
+        }
+    }
+
+    if ( victim < 0 )
+        return -1;
+
+    channels[victim].effect = effect;
+    channels[victim].note = 0;
+    channels[victim].started = now;
+    sfx_start_note(victim, now);
+
+    return victim;
+}
+
+/***************************************************************
+ * sfx_stop()
+ *
+ *  Stop all channels playing a sound effect.
+ *
+ *  Param:  Sound effect
+ *  return: none
+ *
+ */
+void sfx_stop(const sfx_t *effect)
+{
+    for ( int i = 0; i < SFX_CHANNELS; i++ )
+    {
+        if ( channels[i].effect == effect )
+        {
+            audio_voice_off(i);
+            channels[i].effect = 0;
+        }
+    }
+}
+
+/***************************************************************
+ * sfx_is_playing()
+ *
+ *  Check if a sound effect is playing on any channel.
+ *
+ *  Param:  Sound effect
+ *  return: 1 if playing, 0 if not
+ *
+ */
+int sfx_is_playing(const sfx_t *effect)
+{
+    for ( int i = 0; i < SFX_CHANNELS; i++ )
+    {
+        if ( channels[i].effect == effect )
+            return 1;
+    }
+
+    return 0;
+}
+
+/* ----------------------------------------------------------------------------
+ * sfx_start_note()
+ *
+ *  Start the current note of a channel's effect.
+ *
+ *  Param:  Channel and tick count at note start
+ *  return: none
+ *
+ */
+static void sfx_start_note(int channel, uint32_t start)
+{
+    const sfx_t        *effect = channels[channel].effect;
+    const sfx_note_t   *note = &effect->notes[channels[channel].note];
+
+    channels[channel].note_start = start;
+
+    if ( note->freq == SFX_REST )
+        audio_voice_off(channel);
+    else
+        audio_voice_on(channel, effect->wave, note->freq, effect->volume, effect->envelope);
+}
@@ -0,0 +1,222 @@
+/* stress.c
+ *
+ * Many ball stress mode
+ *
+ * Balls bounce around the screen, and more balls are added every step period.
+ * The first balls are video scanout sprites, the rest are bit blitted into
+ * the dynamic plane, which is cleared and redrawn every frame.
+ * Each step prints the per-frame entity update and draw time for the
+ * ball count, as a repeatable measure of how many objects fit in a frame.
+ * Balls are only blitted during vertical retrace, the draw time does not
+ * include waiting for it, and the balls blitted per frame are counted.
+ *
+ */
+
+#include    <stdlib.h>
+#include    <stdio.h>
+
+#include    "hardware/clocks.h"
+
+#include    "stress.h"
+#include    "entity.h"
+#include    "video.h"
+#include    "io.h"
+#include    "sprites.h"
+
+/* ----------------------------------------------------------------------------
+ * Module definitions
+ */
+#define     STRESS_START        16              // Balls at start up
+#define     STRESS_STEP         16              // Balls added every step
+#define     STRESS_MAX          ENTITY_MAX
+#define     STRESS_SEED         1               // Fixed seed, so runs are repeatable
+
+#define     SPEED_MIN           64              // Ball speed in fixed point pixels per tick
+#define     SPEED_RANGE         448
+
+/* ----------------------------------------------------------------------------
+ * Module function prototypes
+ */
+static void stress_add_balls(int balls);
+
+/* ----------------------------------------------------------------------------
+ * Module globals
+ */
+static uint32_t     max_x_res, max_y_res;
+static uint32_t     cycles_per_usec;
+
+static uint32_t     update_frames, update_total, update_max;   // Per step statistics in CPU cycles
+static uint32_t     draw_frames, draw_total, draw_max;
+static uint32_t     blit_total, blit_min;                   // Balls blitted per frame
+
+/***************************************************************
+ * stress()
+ *
+ *  Move the balls, run as a critical vertical blanking task
+ *  once per field.
+ *
+ *  Param:  none
+ *  return: none
+ *
+ */
+void stress(void)
+{
+    uint32_t    start;
+    uint32_t    cycles;
+
+    start = io_get_cycles();
+
+    entity_update(0, 0, (max_x_res + 1 - SPRITE_BALL_COLS), (max_y_res + 1 - SPRITE_BALL_ROWS));
+
+    cycles = io_get_cycles() - start;
+
+    update_frames++;
+    update_total += cycles;
+    if ( cycles > update_max )
+        update_max = cycles;
+}
+
+/***************************************************************
+ * stress_init()
+ *
+ *  Initialize the stress mode, call after video_init()
+ *
+ *  Param:  none
+ *  return: none
+ *
+ */
+void stress_init(void)
+{
+    max_x_res = video_get_x_res();
+    max_y_res = video_get_y_res();
+    cycles_per_usec = clock_get_hz(clk_sys) / 1000000;
+
+    video_set_plane(VIDEO_PLANE_DYNAMIC);
+    video_clear_screen(0);
+    video_set_plane(VIDEO_PLANE_STATIC);
+    video_clear_screen(0);
+    video_set_default_action(SET);
+
+    for ( int i = 0; i < VIDEO_SPRITES; i++ )
+        video_sprite_set(i, &sprite_ball_image, sprite_ball_mask, i);
+
+    srand(STRESS_SEED);
+
+    entity_init();
+    stress_add_balls(STRESS_START);
+
+    update_frames = update_total = update_max = 0;
+    draw_frames = draw_total = draw_max = 0;
+    blit_total = 0;
+    blit_min = UINT32_MAX;
+}
+
+/***************************************************************
+ * stress_render()
+ *
+ *  Clear the dynamic plane and draw the balls. Balls that do not
+ *  fit in the vertical retrace are not drawn in this frame.
+ *
+ *  Param:  none
+ *  return: none
+ *
+ */
+void stress_render(void)
+{
+    uint32_t    start;
+    uint32_t    cycles;
+    uint32_t    blits;
+
+    start = io_get_cycles();
+
+    video_set_plane(VIDEO_PLANE_DYNAMIC);
+    video_clear_screen(0);
+    blits = entity_draw();
+    video_set_plane(VIDEO_PLANE_STATIC);
+
+    cycles = io_get_cycles() - start;
+
+    blit_total += blits;
+    if ( blits < blit_min )
+        blit_min = blits;
+
+    draw_frames++;
+    draw_total += cycles;
+    if ( cycles > draw_max )
+        draw_max = cycles;
+}
+
+/***************************************************************
+ * stress_step()
+ *
+ *  Print the update and draw time of the step that ended,
+ *  and add balls for the next step.
+ *  Run as a background task once per step period.
+ *
+ *  Param:  none
+ *  return: none
+ *
+ */
+void stress_step(void)
+{
+    int     blitted = entity_count() - VIDEO_SPRITES;
+
+    printf("stress: %3d balls, update avg %4u max %4u uS, draw avg %5u max %5u uS, blits avg %3u min %3u of %3d, %u draws in %u frames\n",
+           entity_count(),
+           (unsigned int)(update_frames ? (update_total / update_frames / cycles_per_usec) : 0),
+           (unsigned int)(update_max / cycles_per_usec),
+           (unsigned int)(draw_frames ? (draw_total / draw_frames / cycles_per_usec) : 0),
+           (unsigned int)(draw_max / cycles_per_usec),
+           (unsigned int)(draw_frames ? (blit_total / draw_frames) : 0),
+           (unsigned int)(draw_frames ? blit_min : 0),
+           ((blitted > 0) ? blitted : 0),
+           (unsigned int)draw_frames, (unsigned int)update_frames);
+
+    stress_add_balls(STRESS_STEP);
+
+    update_frames = update_total = update_max = 0;
+    draw_frames = draw_total = draw_max = 0;
+    blit_total = 0;
+    blit_min = UINT32_MAX;
+}
+
+/* ----------------------------------------------------------------------------
+ * stress_add_balls()
+ *
+ *  Add balls at random positions and velocities, up to STRESS_MAX.
+ *  Balls take the free video sprites first.
+ *
+ *  Param:  Number of balls to add
+ *  return: none
+ *
+ */
+static void stress_add_balls(int balls)
+{
+    int         ball;
+    int32_t     x, y, vx, vy;
+
+    for ( int i = 0; i < balls && entity_count() < STRESS_MAX; i++ )
+    {
+        x = ENTITY_TO_FIXED(rand() % (max_x_res + 1 - SPRITE_BALL_COLS));
+        y = ENTITY_TO_FIXED(rand() % (max_y_res + 1 - SPRITE_BALL_ROWS));
+        vx = SPEED_MIN + (rand() % SPEED_RANGE);
+        vy = SPEED_MIN + (rand() % SPEED_RANGE);
+        if ( rand() & 1 )
+            vx = -vx;
+        if ( rand() & 1 )
+            vy = -vy;
+
+        ball = entity_count();
+
+        if ( ball < VIDEO_SPRITES )
+        {
+            entity_add(x, y, vx, vy, &sprite_ball_image, ball);
+            video_sprite_move(ball, ENTITY_TO_PIXEL(x), ENTITY_TO_PIXEL(y));
+            video_sprite_enable(ball, 1);
+        }
+        else
+        {
+            entity_add(x, y, vx, vy, &sprite_ball_image, ENTITY_NO_SPRITE);
+        }
+    }
+}
@@ -0,0 +1,175 @@
+/* bricks_bench.c
+ *
+ * Host benchmark of brick wall collision lookup
+ *
+ * Times bricks_collide() against a full wall and a near empty wall,
+ * and compares it with testing the ball against every brick.
+ * Lookups are for random swept ball bounding boxes over the wall,
+ * with hit bricks put back so the wall stays the same during a run.
+ *
+ * Build and run on the host:
+ *   cc -O2 -I include -o bricks_bench tools/bricks_bench.c bricks.c
+ *   ./bricks_bench
+ *
+ */
+
+#include    <stdio.h>
+#include    <stdlib.h>
+#include    <time.h>
+
+#include    "bricks.h"
+
+/* ----------------------------------------------------------------------------
+ * Module definitions
+ */
+#define     WALL_COLS           32
+#define     WALL_ROWS           27      // 432 lines of 16 pixel cells
+#define     CELL_SHIFT          4
+#define     BALL_SIZE           15
+#define     BALL_MOVE           4       // Pixels per tick, ball speed at 576 pixels
+#define     LOOKUPS             10000000
+#define     BOXES               4096
+
+/* ----------------------------------------------------------------------------
+ * Function prototypes
+ */
+static double bench_bitset(bricks_t *wall, const int (*box)[4]);
+static double bench_scan(bricks_t *wall, const int (*box)[4]);
+static double now_ns(void);
+
+/* ----------------------------------------------------------------------------
+ * Module globals
+ */
+static int      boxes[BOXES][4];
+static int      hits;
+
+/***************************************************************
+ * main()
+ *
+ */
+int main(void)
+{
+    bricks_t    wall;
+    int         x, y;
+
+    srand(1);
+
+    for ( int i = 0; i < BOXES; i++ )
+    {
+        x = rand() % ((WALL_COLS << CELL_SHIFT) - BALL_SIZE - BALL_MOVE);
+        y = rand() % ((WALL_ROWS << CELL_SHIFT) - BALL_SIZE - BALL_MOVE);
+        boxes[i][0] = x;
+        boxes[i][1] = y;
+        boxes[i][2] = x + BALL_SIZE + BALL_MOVE;
+        boxes[i][3] = y + BALL_SIZE + BALL_MOVE;
+    }
+
+    bricks_init(&wall, 0, 0, CELL_SHIFT, CELL_SHIFT, WALL_COLS, WALL_ROWS);
+    bricks_fill(&wall);
+
+    printf("%-12s %8s %14s %14s\n", "wall", "bricks", "bitset ns", "scan ns");
+    printf("%-12s %8d %14.2f %14.2f\n", "full", bricks_count(&wall), bench_bitset(&wall, boxes), bench_scan(&wall, boxes));
+
+    bricks_init(&wall, 0, 0, CELL_SHIFT, CELL_SHIFT, WALL_COLS, WALL_ROWS);
+    wall.row[WALL_ROWS - 1] = 1UL << (WALL_COLS - 1);
+    wall.count = 1;
+
+    printf("%-12s %8d %14.2f %14.2f\n", "near empty", bricks_count(&wall), bench_bitset(&wall, boxes), bench_scan(&wall, boxes));
+
+    return (hits == -1);
+}
+
+/* ----------------------------------------------------------------------------
+ * bench_bitset()
+ *
+ *  Time bitset collision lookups
+ *
+ *  Param:  Wall, ball bounding boxes
+ *  return: Nano seconds per lookup
+ *
+ */
+static double bench_bitset(bricks_t *wall, const int (*box)[4])
+{
+    double      start;
+    int         col, row;
+    const int   *b;
+
+    start = now_ns();
+
+    for ( int i = 0; i < LOOKUPS; i++ )
+    {
+        b = box[i & (BOXES - 1)];
+
+        if ( bricks_collide(wall, b[0], b[1], b[2], b[3], &col, &row) )
+        {
+            wall->row[row] |= 1UL << col;
+            wall->count++;
+            hits++;
+        }
+    }
+
+    return (now_ns() - start) / LOOKUPS;
+}
+
+/* ----------------------------------------------------------------------------
+ * bench_scan()
+ *
+ *  Time lookups that test the ball against every brick in the wall
+ *
+ *  Param:  Wall, ball bounding boxes
+ *  return: Nano seconds per lookup
+ *
+ */
+static double bench_scan(bricks_t *wall, const int (*box)[4])
+{
+    double      start;
+    int         cell = 1 << CELL_SHIFT;
+    int         bx, by;
+    const int   *b;
+
+    start = now_ns();
+
+    for ( int i = 0; i < LOOKUPS; i++ )
+    {
+        b = box[i & (BOXES - 1)];
+
+        for ( int r = 0; r < wall->rows; r++ )
+        {
+            for ( int c = 0; c < wall->cols; c++ )
+            {
+                if ( !bricks_test(wall, c, r) )
+                    continue;
+
+                bx = wall->x0 + c * cell;
+                by = wall->y0 + r * cell;
+
+                if ( b[2] >= bx && b[0] < bx + cell && b[3] >= by && b[1] < by + cell )
+                {
+                    hits++;
+                    r = wall->rows;
+                    break;
+                }
+            }
+        }
+    }
+
+    return (now_ns() - start) / LOOKUPS;
+}
+
+/* ----------------------------------------------------------------------------
+ * now_ns()
+ *
+ *  Monotonic time stamp
+ *
+ *  Param:  none
+ *  return: Time in nano seconds
+ *
+ */
+static double now_ns(void)
+{
+    struct timespec     ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (ts.tv_sec * 1e9) + ts.tv_nsec;
+}
@@ -0,0 +1,120 @@
+#!/usr/bin/env python3
+#
+# fbstream_decode.py
+#
+# Rebuild frames from the frame buffer stream (see fbstream.c) captured
+# from the stdio UART. Text that is not part of a packet, such as the
+# telemetry prints, is passed to stdout. Packets with a bad checksum are
+# dropped, their lines are refreshed by later packets.
+#
+# Each frame is written as a PBM image <output>NNNNNN.pbm. Game ticks
+# with no changes are filled with copies of the last frame, so the images
+# are one per tick and can be made into a video, for example at 60Hz:
+#   ffmpeg -framerate 60 -i frames/%06d.pbm fbstream.mp4
+#
+# Usage: fbstream_decode.py [-o <output prefix>] <capture file>
+#        fbstream_decode.py [-o <output prefix>] -p /dev/ttyACM0 [-b 115200]
+#        (reading a serial port needs pyserial)
+#
+
+import argparse
+import os
+import struct
+import sys
+
+from serial_packets import PacketReader, add_source_arguments, read_source
+
+FRAME = ord('F')
+LINE = ord('L')
+OTHER = (ord('T'), ord('N'))    # Event trace packets, see trace_decode.py
+MAX_GAP = 600                   # Most copies of a frame for a tick gap, 10 seconds at 60Hz
+
+
+class Decoder:
+    """ Frame builder. """
+
+    def __init__(self, prefix):
+        self.prefix = prefix
+        self.width = 0
+        self.height = 0
+        self.rows = []
+        self.tick = None
+        self.frames = 0
+
+    def packet(self, kind, payload):
+        if kind == FRAME:
+            tick, width, height = struct.unpack('<IHH', payload)
+            if (width, height) != (self.width, self.height):
+                self.width, self.height = width, height
+                self.rows = [bytes(width) for _ in range(height)]
+            elif self.tick is not None:
+                gap = (tick - self.tick) & 0xffffffff
+                for _ in range(min(gap, MAX_GAP)):
+                    self.write()
+            self.tick = tick
+        elif kind == LINE and self.width:
+            row = payload[0] | (payload[1] << 8)
+            if row < self.height:
+                self.rows[row] = line(payload[2:], self.width)
+
+    def write(self):
+        """ Write the current frame. """
+        name = '%s%06d.pbm' % (self.prefix, self.frames)
+        with open(name, 'wb') as image_file:
+            image_file.write(b'P4\n%d %d\n' % (self.width, self.height))
+            for row in self.rows:
+                packed = bytearray((self.width + 7) // 8)
+                for x, pixel in enumerate(row):
+                    if pixel:
+                        packed[x // 8] |= 0x80 >> (x % 8)
+                image_file.write(packed)
+        self.frames += 1
+
+    def finish(self):
+        if self.tick is not None:
+            self.write()
+
+
+def line(data, width):
+    """ Decode alternating black and white LEB128 runs, starting with black, into a line of pixels. """
+    pixels = bytearray()
+    color = 0
+    run = 0
+    shift = 0
+    for byte in data:
+        run |= (byte & 0x7f) << shift
+        shift += 7
+        if byte & 0x80:
+            continue
+        pixels += bytes([color]) * run
+        color ^= 1
+        run = 0
+        shift = 0
+    return bytes(pixels[:width].ljust(width, b'\0'))
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Rebuild frames from a frame buffer stream')
+    parser.add_argument('-o', '--output', default='frames/', help='output file prefix, default frames/')
+    add_source_arguments(parser)
+    args = parser.parse_args()
+
+    if bool(args.port) == bool(args.capture):
+        parser.error('give a capture file or a serial port')
+
+    if os.path.dirname(args.output):
+        os.makedirs(os.path.dirname(args.output), exist_ok=True)
+
+    reader = PacketReader((FRAME, LINE) + OTHER)
+    decoder = Decoder(args.output)
+
+    read_source(args, reader, decoder.packet)
+
+    decoder.finish()
+    print('%d frames, %d bad packets' % (decoder.frames, reader.bad), file=sys.stderr)
+
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,22 @@
+/* pico.h
+ *
+ * Host build of the hardware-free firmware modules, for the tools.
+ * Stands in for the SDK's pico.h, whose code placement attributes
+ * have no meaning on the host.
+ *
+ */
+
+#ifndef     __PICO_H__
+#define     __PICO_H__
+
+#include    <stdint.h>
+#include    <stdbool.h>
+#include    <stddef.h>
+
+#define     __not_in_flash_func(func)   func
+#define     __scratch_x(group)
+#define     __scratch_y(group)
+
+typedef unsigned int    uint;
+
+#endif  /* __PICO_H__ */
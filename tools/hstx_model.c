@@ -0,0 +1,366 @@
+/* hstx_model.c
+ *
+ * Host model of the HSTX command expander output for the scan lines
+ *
+ * scanline.c is compiled into the model. Every sync and blank line, and an
+ * active line set up by scanline_active_init() with random pixels, is run
+ * through a model of the expander (RAW and RAW_REPEAT commands, one output
+ * word per raw data word). The output of each line must be its scan line
+ * table rotated by one word, and a whole field of lines, sequenced as the
+ * scan line interrupt does, must be the stream of tables delayed by one word.
+ * Then the words sent by DMA per line and per field are printed for the
+ * tables and the command lists.
+ *
+ * Build and run on the host:
+ *   cc -O2 -I tools/host -I include -o hstx_model tools/hstx_model.c scanline.c
+ *   ./hstx_model
+ *
+ */
+
+#include    <stdio.h>
+#include    <stdlib.h>
+#include    <string.h>
+
+#include    "scanline.h"
+
+/* ----------------------------------------------------------------------------
+ * Module definitions
+ */
+#define     STREAM_MAX          (VID_LINES_PER_FIELD * EQ_PULSE_BUF_LEN)
+#define     CMD_MASK            0xf000
+#define     COUNT_MASK          0x0fff
+
+typedef struct
+{
+    uint32_t    words[STREAM_MAX];
+    int         count;
+} stream_t;
+
+/* ----------------------------------------------------------------------------
+ * Function prototypes
+ */
+static int  expand(const uint32_t *words, int count, stream_t *out);
+static void table(const uint32_t *line, int words, stream_t *out);
+static int  check_line(const char *name, const vid_line_t *line, const uint32_t *line_table, int words);
+static int  check_active(void);
+static int  check_field(int even_field);
+
+/* ----------------------------------------------------------------------------
+ * Module globals
+ */
+static stream_t     sent;
+static stream_t     expected;
+
+/***************************************************************
+ * main()
+ *
+ */
+int main(void)
+{
+    int     failures = 0;
+    int     pool = 0;
+
+    scanline_init();
+
+    printf("expander %s, %d words per scan line\n", VIDEO_HSTX_EXPAND ? "on" : "off", SCAN_LINE_BUF_LEN);
+    printf("%-16s %8s %8s\n", "line", "table", "sent");
+
+    failures += check_line("blank", &vid_blank_line, vid_blank_scan_line, SCAN_LINE_BUF_LEN);
+    failures += check_line("blank half", &vid_blank_half_line, vid_blank_half_scan_line, HALF_SCAN_LINE_BUF_LEN);
+    failures += check_line("equalizing", &vid_equalizing_line, vid_equalizing_pulse, SCAN_LINE_BUF_LEN);
+    failures += check_line("equalizing long", &vid_equalizing_long_line, vid_equalizing_pulse, EQ_PULSE_BUF_LEN);
+    failures += check_line("vertical sync", &vid_vert_sync_line, vid_vert_sync, SCAN_LINE_BUF_LEN);
+    failures += check_line("blank word", &vid_blank_word_line, vid_blank_scan_line, 1);
+    failures += check_active();
+
+    pool = vid_blank_line.count + vid_blank_half_line.count + vid_equalizing_line.count +
+           vid_equalizing_long_line.count + vid_vert_sync_line.count + vid_blank_word_line.count;
+
+    printf("sync tables %d words, ", SCAN_LINE_BUF_LEN + HALF_SCAN_LINE_BUF_LEN + EQ_PULSE_BUF_LEN + SCAN_LINE_BUF_LEN);
+    if ( VIDEO_HSTX_EXPAND )
+        printf("command lists %d of %d words\n", pool, VID_CMD_POOL_LEN);
+    else
+        printf("no command lists\n");
+
+    failures += check_field(0);
+    if ( VIDEO_SCAN_MODE != VIDEO_PROGRESSIVE )
+        failures += check_field(1);
+
+    printf("%s\n", failures ? "FAIL" : "PASS");
+
+    return (failures != 0);
+}
+
+/* ----------------------------------------------------------------------------
+ * expand()
+ *
+ *  Model of the expander, or of the FIFO without it, appending
+ *  the words sent to the output shift register to a stream
+ *
+ *  Param:  FIFO words and count, output stream
+ *  return: 0 if the words are well formed commands, -1 if not
+ *
+ */
+static int expand(const uint32_t *words, int count, stream_t *out)
+{
+    uint32_t    length;
+    int         i = 0;
+
+    if ( !VIDEO_HSTX_EXPAND )
+    {
+        memcpy(&out->words[out->count], words, count * sizeof(uint32_t));
+        out->count += count;
+        return 0;
+    }
+
+    while ( i < count )
+    {
+        length = words[i] & COUNT_MASK;
+
+        if ( (words[i] & 0xffff0000) != 0 )
+            return -1;
+
+        switch ( words[i] & CMD_MASK )
+        {
+        case VID_CMD_RAW:
+            if ( (i + 1 + (int)length) > count )
+                return -1;
+            memcpy(&out->words[out->count], &words[i + 1], length * sizeof(uint32_t));
+            out->count += length;
+            i += 1 + length;
+            break;
+
+        case VID_CMD_RAW_REPEAT:
+            if ( (i + 2) > count )
+                return -1;
+            for ( uint32_t j = 0; j < length; j++ )
+                out->words[out->count++] = words[i + 1];
+            i += 2;
+            break;
+
+        default:
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/* ----------------------------------------------------------------------------
+ * table()
+ *
+ *  Append the words a scan line table should produce: the table rotated
+ *  by one word with the expander, the table as it is without it
+ *
+ *  Param:  Scan line table and length in words, output stream
+ *  return: none
+ *
+ */
+static void table(const uint32_t *line, int words, stream_t *out)
+{
+    int     rotate = VIDEO_HSTX_EXPAND ? 1 : 0;
+
+    for ( int i = 0; i < words; i++ )
+        out->words[out->count++] = line[(i + rotate) % words];
+}
+
+/* ----------------------------------------------------------------------------
+ * check_line()
+ *
+ *  Check the output of a sync or blank line
+ *
+ *  Param:  Name, line, its scan line table and length in words
+ *  return: 0 if correct
+ *
+ */
+static int check_line(const char *name, const vid_line_t *line, const uint32_t *line_table, int words)
+{
+    sent.count = 0;
+    expected.count = 0;
+
+    table(line_table, words, &expected);
+
+    printf("%-16s %8d %8u\n", name, words, line->count);
+
+    if ( expand(line->words, line->count, &sent) )
+    {
+        printf("%s: bad command list\n", name);
+        return 1;
+    }
+
+    if ( VIDEO_HSTX_EXPAND && line_table[0] != 0 )
+    {
+        printf("%s: first word is not blank\n", name);
+        return 1;
+    }
+
+    if ( sent.count != expected.count ||
+         memcmp(sent.words, expected.words, sent.count * sizeof(uint32_t)) )
+    {
+        printf("%s: output differs, %d words for %d\n", name, sent.count, expected.count);
+        return 1;
+    }
+
+    return 0;
+}
+
+/* ----------------------------------------------------------------------------
+ * check_active()
+ *
+ *  Check the output of active lines with random pixels
+ *
+ *  Param:  none
+ *  return: 0 if correct
+ *
+ */
+static int check_active(void)
+{
+    uint32_t    line[SCAN_LINE_BUF_LEN];
+    uint32_t    reference[SCAN_LINE_BUF_LEN];
+
+    printf("%-16s %8d %8d\n", "active", SCAN_LINE_BUF_LEN, VID_ACTIVE_LINE_WORDS);
+
+    for ( int i = 0; i < 1000; i++ )
+    {
+        memset(line, 0, sizeof(line));
+        scanline_active_init(line);
+
+        memset(reference, 0, sizeof(reference));
+        memcpy(reference, vid_blank_scan_line, ACTIVE_VIDEO_OFFSET * sizeof(uint32_t));
+
+        for ( int w = ACTIVE_VIDEO_OFFSET; w < (ACTIVE_VIDEO_OFFSET + VIDEO_ACTIVE_WORDS); w++ )
+            line[w] = reference[w] = (uint32_t)rand() << 16;
+
+        sent.count = 0;
+        expected.count = 0;
+
+        table(reference, SCAN_LINE_BUF_LEN, &expected);
+
+        if ( expand(line, VID_ACTIVE_LINE_WORDS, &sent) ||
+             sent.count != expected.count ||
+             memcmp(sent.words, expected.words, sent.count * sizeof(uint32_t)) )
+        {
+            printf("active: output differs\n");
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/* ----------------------------------------------------------------------------
+ * check_field()
+ *
+ *  Check a field of scan lines, in the scan line interrupt's sequence,
+ *  against the stream of the scan line tables delayed by one word
+ *
+ *  Param:  Even (second interlaced) field
+ *  return: 0 if correct
+ *
+ */
+static int check_field(int even_field)
+{
+    const int   vsync = VID_EQ_LINES;
+    const int   post_eq = vsync + VID_VSYNC_LINES;
+    const int   pre_render = post_eq + VID_EQ_LINES;
+    const int   post_render = VID_FIRST_ACTIVE_LINE + VID_ACTIVE_LINES;
+    uint32_t    active[SCAN_LINE_BUF_LEN];
+    uint32_t    active_table[SCAN_LINE_BUF_LEN];
+    uint32_t    raw[STREAM_MAX];
+    int         raw_count = 0;
+    int         dma_words = 0;
+    int         bad = 0;
+    const vid_line_t *line;
+    const uint32_t   *line_table;
+    int         words;
+
+    memset(active, 0, sizeof(active));
+    scanline_active_init(active);
+
+    memset(active_table, 0, sizeof(active_table));
+    memcpy(active_table, vid_blank_scan_line, ACTIVE_VIDEO_OFFSET * sizeof(uint32_t));
+
+    sent.count = 0;
+
+    for ( int scan_line = 0; scan_line < VID_LINES_PER_FIELD; scan_line++ )
+    {
+        line = 0;
+        line_table = vid_blank_scan_line;
+        words = SCAN_LINE_BUF_LEN;
+
+        if ( scan_line < vsync )
+        {
+            line = &vid_equalizing_line;
+            line_table = vid_equalizing_pulse;
+        }
+        else if ( scan_line < post_eq )
+        {
+            line = &vid_vert_sync_line;
+            line_table = vid_vert_sync;
+        }
+        else if ( scan_line < pre_render )
+        {
+            line = &vid_equalizing_line;
+            line_table = vid_equalizing_pulse;
+            if ( scan_line == (pre_render - 1) && even_field )
+            {
+                line = &vid_equalizing_long_line;
+                words = EQ_PULSE_BUF_LEN;
+            }
+        }
+        else if ( scan_line < VID_FIRST_ACTIVE_LINE || scan_line >= post_render )
+        {
+            line = &vid_blank_line;
+            if ( scan_line == (VID_LINES_PER_FIELD - 1) && VIDEO_SCAN_MODE != VIDEO_PROGRESSIVE )
+            {
+                line = even_field ? &vid_blank_word_line : &vid_blank_half_line;
+                line_table = even_field ? vid_blank_scan_line : vid_blank_half_scan_line;
+                words = even_field ? 1 : HALF_SCAN_LINE_BUF_LEN;
+            }
+        }
+
+        /* The scan line tables as they were sent before the expander
+         */
+        memcpy(&raw[raw_count], line ? line_table : active_table, words * sizeof(uint32_t));
+        raw_count += words;
+
+        if ( line )
+        {
+            bad |= expand(line->words, line->count, &sent);
+            dma_words += line->count;
+        }
+        else
+        {
+            bad |= expand(active, VID_ACTIVE_LINE_WORDS, &sent);
+            dma_words += VID_ACTIVE_LINE_WORDS;
+        }
+    }
+
+    /* Delayed by one (blank) word with the expander
+     */
+    expected.count = 0;
+    if ( VIDEO_HSTX_EXPAND )
+    {
+        memcpy(expected.words, &raw[1], (raw_count - 1) * sizeof(uint32_t));
+        expected.words[raw_count - 1] = raw[0];
+        expected.count = raw_count;
+    }
+    else
+    {
+        memcpy(expected.words, raw, raw_count * sizeof(uint32_t));
+        expected.count = raw_count;
+    }
+
+    printf("%s field: %d output words, DMA words %d with tables, %d sent, %d of them in blanking\n",
+           even_field ? "even" : "odd", sent.count, raw_count, dma_words,
+           dma_words - (VID_ACTIVE_LINES * VID_ACTIVE_LINE_WORDS));
+
+    if ( bad || sent.count != expected.count ||
+         memcmp(sent.words, expected.words, sent.count * sizeof(uint32_t)) )
+    {
+        printf("%s field: output differs\n", even_field ? "even" : "odd");
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,341 @@
+#!/usr/bin/env python3
+#
+# img2sprite.py
+#
+# Convert 1 bit images to C sprite tables in the bit blit format:
+# rows of bytes, MSB is the leftmost pixel, a row padded to whole bytes.
+#
+# Images are PBM (P1 text or P4 binary) or PNG files. A PBM '1' pixel
+# and a PNG pixel brighter than half intensity (and not transparent)
+# are lit. An image named '<name>_mask.<ext>' next to an image is its
+# mask, the pixels hidden under the sprite. An image can hold several
+# frames of the same size stacked vertically, such as font glyphs.
+#
+# For each image 'name' the header defines SPRITE_<NAME>_COLS and _ROWS
+# (of a frame), _FRAMES, and declares the const tables sprite_<name>[],
+# sprite_<name>_mask[] if there is a mask, and bit_blit_t sprite_<name>_image
+# for the first frame.
+#
+# An image followed by ':rle' is run length encoded instead (see video_rle_t
+# in video.h), for large images such as screens. The header defines
+# IMAGE_<NAME>_COLS and _ROWS and declares video_rle_t image_<name>,
+# and the compression ratio is printed.
+#
+# An image followed by ':tiles' (or ':<frames>:tiles') is cut into 8x8 tiles
+# for the tile map (see video_tile_set() in video.c), frame by frame, each
+# frame's tiles in rows left to right and padded with black. The tiles of all
+# images go into one tile set, tile_set[], after a blank tile 0. The header
+# defines TILE_<NAME>, the first tile of the image, TILE_<NAME>_COLS and _ROWS
+# (of a frame in tiles), _FRAMES, and TILE_SET_COUNT.
+#
+# Usage: img2sprite.py -o <output base name> <image>[:<frames>][:tiles]|[:rle] ...
+#        writes <output base name>.h and <output base name>.c
+#
+
+import argparse
+import os
+import re
+import struct
+import sys
+import zlib
+
+TILE_SIZE = 8
+
+def read_pbm(path):
+    """ Return (width, height, rows of 0/1 pixels) of a P1 or P4 PBM file. """
+    with open(path, 'rb') as image_file:
+        data = image_file.read()
+
+    # Header tokens, skipping comments, up to the raster
+    tokens = []
+    pos = 0
+    while len(tokens) < 3:
+        match = re.compile(rb'\s*(#[^\n]*\n\s*)*(\S+)').match(data, pos)
+        if not match:
+            raise ValueError('%s: bad PBM header' % path)
+        tokens.append(match.group(2))
+        pos = match.end()
+
+    magic, width, height = tokens[0], int(tokens[1]), int(tokens[2])
+
+    if magic == b'P1':
+        bits = [int(b) for b in re.sub(rb'#[^\n]*', b'', data[pos:]) if b in b'01']
+        bits = [b - ord('0') for b in bits]
+        if len(bits) < width * height:
+            raise ValueError('%s: short PBM raster' % path)
+        return width, height, [bits[r * width:(r + 1) * width] for r in range(height)]
+
+    if magic == b'P4':
+        pos += 1
+        row_bytes = (width + 7) // 8
+        rows = []
+        for r in range(height):
+            row = data[pos + r * row_bytes:pos + (r + 1) * row_bytes]
+            rows.append([(row[c // 8] >> (7 - c % 8)) & 1 for c in range(width)])
+        return width, height, rows
+
+    raise ValueError('%s: not a P1 or P4 PBM file' % path)
+
+
+def read_png(path):
+    """ Return (width, height, rows of 0/1 pixels) of a non interlaced PNG file. """
+    with open(path, 'rb') as image_file:
+        data = image_file.read()
+
+    if data[:8] != b'\x89PNG\r\n\x1a\n':
+        raise ValueError('%s: not a PNG file' % path)
+
+    pos = 8
+    idat = b''
+    palette = []
+    transparency = b''
+    while pos < len(data):
+        length, kind = struct.unpack('>I4s', data[pos:pos + 8])
+        chunk = data[pos + 8:pos + 8 + length]
+        pos += 12 + length
+        if kind == b'IHDR':
+            width, height, depth, color, _, _, interlace = struct.unpack('>IIBBBBB', chunk)
+        elif kind == b'PLTE':
+            palette = [tuple(chunk[i:i + 3]) for i in range(0, length, 3)]
+        elif kind == b'tRNS':
+            transparency = chunk
+        elif kind == b'IDAT':
+            idat += chunk
+        elif kind == b'IEND':
+            break
+
+    if interlace:
+        raise ValueError('%s: interlaced PNG is not supported' % path)
+
+    channels = {0: 1, 2: 3, 3: 1, 4: 2, 6: 4}[color]
+    pixel_bits = channels * depth
+    stride = (width * pixel_bits + 7) // 8
+    step = max(1, pixel_bits // 8)
+    raw = zlib.decompress(idat)
+
+    rows = []
+    prior = bytearray(stride)
+    for r in range(height):
+        kind = raw[r * (stride + 1)]
+        line = bytearray(raw[r * (stride + 1) + 1:(r + 1) * (stride + 1)])
+        for i in range(stride):
+            a = line[i - step] if i >= step else 0
+            b = prior[i]
+            c = prior[i - step] if i >= step else 0
+            if kind == 1:
+                line[i] = (line[i] + a) & 0xff
+            elif kind == 2:
+                line[i] = (line[i] + b) & 0xff
+            elif kind == 3:
+                line[i] = (line[i] + (a + b) // 2) & 0xff
+            elif kind == 4:
+                p = a + b - c
+                pa, pb, pc = abs(p - a), abs(p - b), abs(p - c)
+                line[i] = (line[i] + (a if pa <= pb and pa <= pc else b if pb <= pc else c)) & 0xff
+        prior = line
+
+        # Samples scaled to 8 bits
+        samples = []
+        for i in range(width * channels):
+            if depth == 16:
+                samples.append(line[2 * i])
+            elif depth == 8:
+                samples.append(line[i])
+            else:
+                value = (line[(i * depth) // 8] >> (8 - depth - (i * depth) % 8)) & ((1 << depth) - 1)
+                samples.append(value if color == 3 else (value * 255) // ((1 << depth) - 1))
+
+        row = []
+        for x in range(width):
+            pixel = samples[x * channels:(x + 1) * channels]
+            alpha = 255
+            if color == 3:
+                index = pixel[0]
+                pixel = palette[index]
+                if index < len(transparency):
+                    alpha = transparency[index]
+            elif color in (4, 6):
+                alpha = pixel[-1]
+                pixel = pixel[:-1]
+            row.append(1 if alpha >= 128 and sum(pixel) / len(pixel) >= 128 else 0)
+        rows.append(row)
+
+    return width, height, rows
+
+
+def read_image(path):
+    if path.lower().endswith('.png'):
+        return read_png(path)
+    return read_pbm(path)
+
+
+def pack(rows, width):
+    """ Pack pixel rows into bit blit bytes. """
+    packed = []
+    for row in rows:
+        for byte in range(0, width, 8):
+            value = 0
+            for bit in range(8):
+                if byte + bit < width and row[byte + bit]:
+                    value |= 0x80 >> bit
+            packed.append(value)
+    return packed
+
+
+def rle(rows):
+    """ Encode pixel rows as alternating black and white LEB128 run lengths, starting with black. """
+    encoded = []
+    color = 0
+    run = 0
+    for pixel in [p for row in rows for p in row]:
+        if pixel != color:
+            encoded.append(run)
+            color = pixel
+            run = 0
+        run += 1
+    encoded.append(run)
+
+    data = []
+    for run in encoded:
+        while run >= 0x80:
+            data.append((run & 0x7f) | 0x80)
+            run >>= 7
+        data.append(run)
+    return data
+
+
+def c_table(name, packed, row_bytes, comment, static=False):
+    lines = ['/* %s */' % comment, '%sconst uint8_t %s[%d] =' % ('static ' if static else '', name, len(packed)), '{']
+    per_line = row_bytes * max(1, 8 // row_bytes)
+    for i in range(0, len(packed), per_line):
+        lines.append('    ' + ' '.join('0x%02x,' % b for b in packed[i:i + per_line]))
+    lines.append('};')
+    return '\n'.join(lines) + '\n'
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Convert 1 bit images to C sprite tables')
+    parser.add_argument('-o', '--output', required=True, help='output base name, .h and .c are added')
+    parser.add_argument('images', nargs='+', help='image file, optionally followed by :<frames>')
+    args = parser.parse_args()
+
+    base = os.path.basename(args.output)
+    guard = '__%s_H__' % re.sub(r'\W', '_', base).upper()
+    header = ['/* %s.h' % base, ' *',
+              ' * Sprite tables generated by tools/img2sprite.py, do not edit.',
+              ' * Source images are in assets/.', ' *', ' */', '',
+              '#ifndef     %s' % guard, '#define     %s' % guard, '',
+              '#include    <stdint.h>', '', '#include    "video.h"', '']
+    source = ['/* %s.c' % base, ' *',
+              ' * Sprite tables generated by tools/img2sprite.py, do not edit.', ' *', ' */', '',
+              '#include    "%s.h"' % base, '']
+
+    tile_set = [0] * TILE_SIZE
+
+    for spec in args.images:
+        path, _, frames = spec.partition(':')
+        name = os.path.splitext(os.path.basename(path))[0]
+        upper = name.upper()
+
+        width, height, rows = read_image(path)
+
+        if frames.endswith('tiles'):
+            frames = int(frames.partition(':')[0]) if frames != 'tiles' else 1
+            if height % frames:
+                print('%s: %d rows do not divide into %d frames' % (path, height, frames), file=sys.stderr)
+                return 1
+
+            frame_rows = height // frames
+            tile_cols = (width + TILE_SIZE - 1) // TILE_SIZE
+            tile_rows = (frame_rows + TILE_SIZE - 1) // TILE_SIZE
+            first = len(tile_set) // TILE_SIZE
+
+            for frame in range(frames):
+                frame_pixels = rows[frame * frame_rows:(frame + 1) * frame_rows]
+                for tile_row in range(tile_rows):
+                    for tile_col in range(tile_cols):
+                        for r in range(tile_row * TILE_SIZE, (tile_row + 1) * TILE_SIZE):
+                            row = frame_pixels[r] if r < frame_rows else []
+                            value = 0
+                            for bit in range(TILE_SIZE):
+                                c = tile_col * TILE_SIZE + bit
+                                if c < width and r < frame_rows and row[c]:
+                                    value |= 0x80 >> bit
+                            tile_set.append(value)
+
+            if len(tile_set) // TILE_SIZE > 256:
+                print('%s: more than 256 tiles in the tile set' % path, file=sys.stderr)
+                return 1
+
+            header.append('#define     TILE_%-18s %d' % (upper, first))
+            header.append('#define     TILE_%-18s %d' % (upper + '_COLS', tile_cols))
+            header.append('#define     TILE_%-18s %d' % (upper + '_ROWS', tile_rows))
+            header.append('#define     TILE_%-18s %d' % (upper + '_FRAMES', frames))
+            header.append('')
+            continue
+
+        if frames == 'rle':
+            data = rle(rows)
+            raw = ((width + 7) // 8) * height
+            print('%s: %dx%d, %d bytes raw, %d bytes RLE, ratio %.1f:1' %
+                  (os.path.basename(path), width, height, raw, len(data), raw / len(data)))
+
+            header.append('#define     IMAGE_%-17s %d' % (upper + '_COLS', width))
+            header.append('#define     IMAGE_%-17s %d' % (upper + '_ROWS', height))
+            header.append('extern const video_rle_t image_%s;' % name)
+            header.append('')
+            source.append(c_table('image_%s_rle' % name, data, 1,
+                                  '%s, %dx%d, %d bytes raw' % (os.path.basename(path), width, height, raw), static=True))
+            source.append('const video_rle_t image_%s = { image_%s_rle, %d, %d, %d };\n' %
+                          (name, name, len(data), width, height))
+            continue
+
+        frames = int(frames) if frames else 1
+        if height % frames:
+            print('%s: %d rows do not divide into %d frames' % (path, height, frames), file=sys.stderr)
+            return 1
+
+        row_bytes = (width + 7) // 8
+        frame_rows = height // frames
+
+        header.append('#define     SPRITE_%-16s %d' % (upper + '_COLS', width))
+        header.append('#define     SPRITE_%-16s %d' % (upper + '_ROWS', frame_rows))
+        header.append('#define     SPRITE_%-16s %d' % (upper + '_FRAMES', frames))
+        header.append('extern const uint8_t     sprite_%s[%d];' % (name, row_bytes * height))
+
+        source.append(c_table('sprite_%s' % name, pack(rows, width), row_bytes,
+                              '%s, %dx%d, %d frame(s)' % (os.path.basename(path), width, frame_rows, frames)))
+
+        mask_path = re.sub(r'(\.\w+)$', r'_mask\1', path)
+        if os.path.exists(mask_path):
+            mask_width, mask_height, mask_rows = read_image(mask_path)
+            if (mask_width, mask_height) != (width, height):
+                print('%s: mask size does not match the image' % mask_path, file=sys.stderr)
+                return 1
+            header.append('extern const uint8_t     sprite_%s_mask[%d];' % (name, row_bytes * height))
+            source.append(c_table('sprite_%s_mask' % name, pack(mask_rows, width), row_bytes,
+                                  '%s, pixels hidden under the sprite' % os.path.basename(mask_path)))
+
+        header.append('extern const bit_blit_t  sprite_%s_image;' % name)
+        header.append('')
+        source.append('const bit_blit_t sprite_%s_image = { sprite_%s, %d, %d };\n' % (name, name, width, frame_rows))
+
+    if len(tile_set) > TILE_SIZE:
+        header.append('#define     %-23s %d' % ('TILE_SET_COUNT', len(tile_set) // TILE_SIZE))
+        header.append('extern const uint8_t     tile_set[%d];' % len(tile_set))
+        header.append('')
+        source.append(c_table('tile_set', tile_set, TILE_SIZE,
+                              'Tile set, %d tiles of 8x8, tile 0 is blank' % (len(tile_set) // TILE_SIZE)))
+
+    header.append('#endif  /* %s */' % guard)
+
+    with open(args.output + '.h', 'w') as header_file:
+        header_file.write('\n'.join(header) + '\n')
+    with open(args.output + '.c', 'w') as source_file:
+        source_file.write('\n'.join(source))
+
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
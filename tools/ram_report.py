@@ -0,0 +1,123 @@
+#!/usr/bin/env python3
+#
+# ram_report.py
+#
+# Report RAM use per module from a GNU ld linker map file.
+# Input sections are assigned to memory regions by their (run time) address,
+# so initialized data and RAM resident code (.data, .time_critical)
+# count in RAM, and scratch bank placements are shown separately.
+#
+# Usage: ram_report.py pico-pong.elf.map
+#
+
+import os
+import re
+import sys
+
+SECTION_LINE = re.compile(r'^ (\S+)\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)\s+(\S.*)$')
+SECTION_NAME = re.compile(r'^ (\S+)$')
+SECTION_DATA = re.compile(r'^\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)\s+(\S.*)$')
+REGION_LINE = re.compile(r'^(\S+)\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)')
+
+
+def module_name(path):
+    """ Object file path to a module name, archive members are grouped by archive. """
+    path = path.strip()
+    archive = re.match(r'^(.*\.a)\(.*\)$', path)
+    if archive:
+        return os.path.basename(archive.group(1))
+    name = os.path.basename(path)
+    for ext in ('.obj', '.o'):
+        if name.endswith(ext):
+            name = name[:-len(ext)]
+    return name
+
+
+def read_map(lines):
+    """ Return memory regions {name: (origin, length)} and a list of (section, address, size, module). """
+    regions = {}
+    sections = []
+    state = None
+    pending = None
+
+    for line in lines:
+        line = line.rstrip('\n')
+
+        if line.startswith('Memory Configuration'):
+            state = 'memory'
+            continue
+        if line.startswith('Linker script and memory map'):
+            state = 'map'
+            continue
+
+        if state == 'memory':
+            match = REGION_LINE.match(line)
+            if match and match.group(1) not in ('Name', '*default*'):
+                regions[match.group(1)] = (int(match.group(2), 16), int(match.group(3), 16))
+            continue
+
+        if state != 'map':
+            continue
+
+        if pending:
+            match = SECTION_DATA.match(line)
+            if match:
+                sections.append((pending, int(match.group(1), 16), int(match.group(2), 16), module_name(match.group(3))))
+            pending = None
+            continue
+
+        match = SECTION_LINE.match(line)
+        if match:
+            if match.group(1) != '*fill*':
+                sections.append((match.group(1), int(match.group(2), 16), int(match.group(3), 16), module_name(match.group(4))))
+            continue
+
+        match = SECTION_NAME.match(line)
+        if match:
+            pending = match.group(1)
+
+    return regions, sections
+
+
+def region_of(regions, address):
+    for name, (origin, length) in regions.items():
+        if origin <= address < origin + length:
+            return name
+    return None
+
+
+def main():
+    if len(sys.argv) != 2:
+        print('usage: ram_report.py <linker map file>', file=sys.stderr)
+        return 1
+
+    with open(sys.argv[1]) as map_file:
+        regions, sections = read_map(map_file)
+
+    ram_regions = [name for name in regions if name != 'FLASH']
+    usage = {}
+
+    for section, address, size, module in sections:
+        region = region_of(regions, address)
+        if size == 0 or region not in ram_regions:
+            continue
+        usage.setdefault(module, {}).setdefault(region, 0)
+        usage[module][region] += size
+
+    print('%-28s' % 'module' + ''.join('%12s' % name for name in ram_regions) + '%12s' % 'total')
+
+    totals = dict.fromkeys(ram_regions, 0)
+    for module in sorted(usage, key=lambda m: -sum(usage[m].values())):
+        print('%-28s' % module + ''.join('%12d' % usage[module].get(name, 0) for name in ram_regions) +
+              '%12d' % sum(usage[module].values()))
+        for name in ram_regions:
+            totals[name] += usage[module].get(name, 0)
+
+    print('%-28s' % 'total' + ''.join('%12d' % totals[name] for name in ram_regions) +
+          '%12d' % sum(totals.values()))
+
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
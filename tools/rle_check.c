@@ -0,0 +1,254 @@
+/* rle_check.c
+ *
+ * Host round trip check of the run length encoded image decoder
+ *
+ * Random 1 bit images are encoded the way tools/img2sprite.py encodes
+ * an image listed with ':rle' (alternating black and white LEB128 run
+ * lengths, starting with black), and decoded with video_rle_image() at
+ * random word aligned positions over a random background. Every row of
+ * the screen is read back with video_read_line(): pixels under the image
+ * must be the image, and all other pixels must be unchanged. Images have
+ * short and long runs, and runs across row ends.
+ *
+ * Build and run on the host:
+ *   cc -O2 -I tools/host -I include -o rle_check tools/rle_check.c scanline.c
+ *   ./rle_check [seed]
+ *
+ */
+
+#include    <stdio.h>
+#include    <stdlib.h>
+#include    <string.h>
+
+#include    "../video.c"
+#include    "../runs.c"
+
+/* ----------------------------------------------------------------------------
+ * Module definitions
+ */
+#define     IMAGES              200
+#define     IMAGE_COLS_MAX      (VIDEO_X_RESOLUTION / 2)
+#define     IMAGE_ROWS_MAX      (VIDEO_Y_RESOLUTION / 2)
+#define     IMAGE_PIXELS_MAX    (IMAGE_COLS_MAX * IMAGE_ROWS_MAX)
+
+/* ----------------------------------------------------------------------------
+ * Function prototypes
+ */
+static void     make_image(uint32_t cols, uint32_t rows);
+static uint32_t encode(uint32_t pixel_count);
+static void     background(void);
+static void     read_screen(uint32_t (*screen)[SCAN_LINE_BUF_LEN]);
+
+/* ----------------------------------------------------------------------------
+ * Module globals
+ */
+static uint8_t      pixels[IMAGE_PIXELS_MAX];
+static uint8_t      data[IMAGE_PIXELS_MAX * 2];
+static uint32_t     before[VIDEO_Y_RESOLUTION][SCAN_LINE_BUF_LEN];
+static uint32_t     after[VIDEO_Y_RESOLUTION][SCAN_LINE_BUF_LEN];
+
+/* Host stand-ins for io.c
+ */
+int io_is_vert_retrace(void)
+{
+    return 1;
+}
+
+uint32_t io_get_cycles(void)
+{
+    return 0;
+}
+
+int io_dma_fill_busy(void)
+{
+    return 0;
+}
+
+void io_dma_fill(uint32_t * const *line_table, uint32_t word_count, uint32_t value, io_callback_t callback)
+{
+    for ( ; *line_table; line_table++ )
+        for ( uint32_t w = 0; w < word_count; w++ )
+            (*line_table)[w] = value;
+
+    if ( callback )
+        callback();
+}
+
+/***************************************************************
+ * main()
+ *
+ */
+int main(int argc, char *argv[])
+{
+    video_rle_t     image;
+    uint32_t        cols, rows, x0, y0, x;
+    uint32_t        raw_bytes = 0, rle_bytes = 0;
+    uint32_t        word, mask, expect;
+    int             failures = 0;
+    int             bad;
+
+    srand((argc > 1) ? atoi(argv[1]) : 1);
+
+    scanline_init();
+    video_init();
+    video_set_plane(VIDEO_PLANE_STATIC);
+
+    for ( int i = 0; i < IMAGES; i++ )
+    {
+        cols = 1 + (rand() % IMAGE_COLS_MAX);
+        rows = 1 + (rand() % IMAGE_ROWS_MAX);
+        make_image(cols, rows);
+
+        image.data = data;
+        image.size = encode(cols * rows);
+        image.col_count = cols;
+        image.row_count = rows;
+
+        raw_bytes += ((cols + 7) / 8) * rows;
+        rle_bytes += image.size;
+
+        x0 = (rand() % (((VIDEO_X_RESOLUTION - cols) >> 4) + 1)) << 4;
+        y0 = rand() % (VIDEO_Y_RESOLUTION - rows + 1);
+
+        background();
+        read_screen(before);
+
+        bad = (video_rle_image(x0, y0, &image) != 0);
+
+        read_screen(after);
+
+        for ( uint32_t y = 0; y < VIDEO_Y_RESOLUTION && !bad; y++ )
+        {
+            for ( uint32_t w = ACTIVE_VIDEO_OFFSET; w < (ACTIVE_VIDEO_OFFSET + VIDEO_ACTIVE_WORDS); w++ )
+            {
+                expect = before[y][w];
+
+                for ( uint32_t bit = 0; bit < 16; bit++ )
+                {
+                    x = ((w - ACTIVE_VIDEO_OFFSET) << 4) + bit;
+
+                    if ( x < x0 || x >= (x0 + cols) || y < y0 || y >= (y0 + rows) )
+                        continue;
+
+                    mask = 0x80000000 >> bit;
+                    word = pixels[((y - y0) * cols) + (x - x0)] ? mask : 0;
+                    expect = (expect & ~mask) | word;
+                }
+
+                if ( after[y][w] != expect )
+                    bad = 1;
+            }
+        }
+
+        if ( bad && failures == 0 )
+            printf("mismatch: image %d, %ux%u at (%u,%u), %u bytes\n", i, cols, rows, x0, y0, image.size);
+
+        failures += bad;
+    }
+
+    printf("%d images, %d mismatches, %u bytes raw, %u bytes RLE\n", IMAGES, failures, raw_bytes, rle_bytes);
+
+    return (failures != 0);
+}
+
+/* ----------------------------------------------------------------------------
+ * make_image()
+ *
+ *  A random image of alternating black and white runs, short runs
+ *  like text edges and long runs like borders and backgrounds
+ *
+ *  Param:  Image size
+ *  return: none
+ *
+ */
+static void make_image(uint32_t cols, uint32_t rows)
+{
+    uint32_t    count = cols * rows;
+    uint32_t    run;
+    uint8_t     color = rand() & 1;
+
+    for ( uint32_t i = 0; i < count; color ^= 1 )
+    {
+        run = (rand() & 1) ? (1 + ((uint32_t)rand() % 8)) : (1 + ((uint32_t)rand() % (2 * cols)));
+
+        for ( ; run && i < count; run--, i++ )
+            pixels[i] = color;
+    }
+}
+
+/* ----------------------------------------------------------------------------
+ * encode()
+ *
+ *  Encode the image pixels as img2sprite.py rle() does
+ *
+ *  Param:  Pixel count
+ *  return: Bytes of run length data
+ *
+ */
+static uint32_t encode(uint32_t pixel_count)
+{
+    uint32_t    size = 0;
+    uint32_t    run = 0;
+    uint8_t     color = 0;
+
+    for ( uint32_t i = 0; i <= pixel_count; i++ )
+    {
+        if ( i == pixel_count || pixels[i] != color )
+        {
+            while ( run >= 0x80 )
+            {
+                data[size++] = (run & 0x7f) | 0x80;
+                run >>= 7;
+            }
+            data[size++] = run;
+
+            color = (i < pixel_count) ? pixels[i] : color;
+            run = 0;
+        }
+
+        run++;
+    }
+
+    return size;
+}
+
+/* ----------------------------------------------------------------------------
+ * background()
+ *
+ *  Clear the screen and draw random white rectangles on it
+ *
+ *  Param:  none
+ *  return: none
+ *
+ */
+static void background(void)
+{
+    uint32_t    x, y;
+
+    video_clear_screen(0);
+
+    for ( int i = 0; i < 64; i++ )
+    {
+        x = rand() % VIDEO_X_RESOLUTION;
+        y = rand() % VIDEO_Y_RESOLUTION;
+        video_fill_rect(x, y, (x + (rand() % 64)), (y + (rand() % 64)), 1, 0);
+    }
+}
+
+/* ----------------------------------------------------------------------------
+ * read_screen()
+ *
+ *  Read every row of the screen as it is scanned out
+ *
+ *  Param:  Rows of scan line words
+ *  return: none
+ *
+ */
+static void read_screen(uint32_t (*screen)[SCAN_LINE_BUF_LEN])
+{
+    for ( uint32_t y = 0; y < VIDEO_Y_RESOLUTION; y++ )
+    {
+        memcpy(screen[y], line_buffer[0], sizeof(screen[y]));
+        video_read_line(y, screen[y]);
+    }
+}
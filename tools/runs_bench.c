@@ -0,0 +1,330 @@
+/* runs_bench.c
+ *
+ * Host benchmark of the dynamic plane storage, bitmap or run lists
+ *
+ * video.c is compiled into the benchmark, built once for each storage
+ * mode. Typical frames are drawn into the dynamic plane: each frame clears
+ * the plane and draws its content at a new position, and then a field is
+ * scanned out by composing every display row with video_scan_line(), as the
+ * scan line interrupt does. The plane's memory, the time to clear, draw and
+ * scan out a frame, and the most runs in use and spans dropped are printed.
+ *
+ * The frames:
+ * - score, the game's dynamic plane: two scores of two digits.
+ * - pong, a whole pong screen: walls, net, paddles, ball and score.
+ * - stress, the balls of the stress mode, STRESS_BALLS of them.
+ * - bricks, a wall of bricks, more runs than the default pool has.
+ *
+ * Build and run on the host, bitmap and then run list dynamic plane:
+ *   cc -O2 -I tools/host -I include -o runs_bench tools/runs_bench.c scanline.c
+ *   ./runs_bench
+ *   cc -O2 -I tools/host -I include -DVIDEO_RUN_PLANE=1 -o runs_bench tools/runs_bench.c scanline.c
+ *   ./runs_bench
+ *
+ */
+
+#include    <stdio.h>
+#include    <stdlib.h>
+#include    <string.h>
+#include    <time.h>
+
+#include    "../video.c"
+#include    "../runs.c"
+
+/* ----------------------------------------------------------------------------
+ * Module definitions
+ */
+#define     FRAMES              2000
+#define     BALL_SIZE           15
+#define     DIGIT_COLS          16
+#define     DIGIT_ROWS          24
+#define     PADDLE_COLS         8
+#define     PADDLE_ROWS         48
+#define     STRESS_BALLS        64
+#define     BRICK_COLS          16
+#define     BRICK_ROWS          8
+#define     BRICK_WALL_COLS     32
+#define     BRICK_WALL_ROWS     8
+
+typedef enum
+{
+    FRAME_SCORE,
+    FRAME_PONG,
+    FRAME_STRESS,
+    FRAME_BRICKS,
+    FRAME_COUNT
+} frame_kind_t;
+
+/* ----------------------------------------------------------------------------
+ * Function prototypes
+ */
+static void     draw_frame(frame_kind_t kind, int frame);
+static void     draw_score(uint32_t x, uint32_t y, int score);
+static void     make_bitmaps(void);
+static uint32_t plane_bytes(void);
+static double   now_ns(void);
+
+/* ----------------------------------------------------------------------------
+ * Module globals
+ */
+static const char  *frame_names[FRAME_COUNT] = { "score", "pong", "stress", "bricks" };
+
+static uint8_t      ball_data[BALL_SIZE * 2];
+static uint8_t      digit_data[DIGIT_ROWS * 2];
+static bit_blit_t   ball = { ball_data, BALL_SIZE, BALL_SIZE };
+static bit_blit_t   digit = { digit_data, DIGIT_COLS, DIGIT_ROWS };
+static int          ball_pos[STRESS_BALLS][2];
+
+/* Host stand-ins for io.c
+ */
+int io_is_vert_retrace(void)
+{
+    return 1;
+}
+
+uint32_t io_get_cycles(void)
+{
+    return 0;
+}
+
+int io_dma_fill_busy(void)
+{
+    return 0;
+}
+
+void io_dma_fill(uint32_t * const *line_table, uint32_t word_count, uint32_t value, io_callback_t callback)
+{
+    for ( ; *line_table; line_table++ )
+        for ( uint32_t w = 0; w < word_count; w++ )
+            (*line_table)[w] = value;
+
+    if ( callback )
+        callback();
+}
+
+/***************************************************************
+ * main()
+ *
+ */
+int main(void)
+{
+    double          start;
+    double          clear_ns, draw_ns, scan_ns;
+    uint32_t        checksum = 0;
+    runs_stats_t    run_stats;
+
+    srand(1);
+
+    scanline_init();
+    video_init();
+    make_bitmaps();
+
+    for ( int i = 0; i < STRESS_BALLS; i++ )
+    {
+        ball_pos[i][0] = rand() % (VIDEO_X_RESOLUTION - BALL_SIZE);
+        ball_pos[i][1] = rand() % (VIDEO_Y_RESOLUTION - BALL_SIZE);
+    }
+
+    if ( VIDEO_RUN_PLANE )
+        printf("dynamic plane: run lists, %d runs, %u bytes\n", VIDEO_RUNS, plane_bytes());
+    else
+        printf("dynamic plane: bitmap, %u bytes\n", plane_bytes());
+
+    printf("%-8s %10s %10s %12s %6s %8s\n", "frame", "clear ns", "draw ns", "scanout ns", "runs", "drops");
+
+    video_set_plane(VIDEO_PLANE_DYNAMIC);
+    video_set_default_action(SET);
+
+    for ( frame_kind_t kind = 0; kind < FRAME_COUNT; kind++ )
+    {
+        clear_ns = draw_ns = scan_ns = 0;
+
+        video_clear_screen(0);
+        if ( VIDEO_RUN_PLANE )
+            runs_get_stats(&run_stats);
+
+        for ( int frame = 0; frame < FRAMES; frame++ )
+        {
+            start = now_ns();
+            video_clear_screen(0);
+            clear_ns += now_ns() - start;
+
+            start = now_ns();
+            draw_frame(kind, frame);
+            draw_ns += now_ns() - start;
+
+            /* A field of scan lines, every other row of an interlaced frame
+             */
+            video_begin_field();
+
+            start = now_ns();
+            for ( uint32_t row = (frame & 1); row < VIDEO_Y_RESOLUTION; row += (VIDEO_Y_RESOLUTION / VID_ACTIVE_LINES) )
+                checksum += video_scan_line(row)[ACTIVE_VIDEO_OFFSET + (row % VIDEO_ACTIVE_WORDS)];
+            scan_ns += now_ns() - start;
+        }
+
+        if ( VIDEO_RUN_PLANE )
+            runs_get_stats(&run_stats);
+        else
+            run_stats.max_used = run_stats.drops = 0;
+
+        printf("%-8s %10.1f %10.1f %12.1f %6u %8u\n",
+               frame_names[kind], clear_ns / FRAMES, draw_ns / FRAMES, scan_ns / FRAMES,
+               run_stats.max_used, run_stats.drops);
+    }
+
+    return (checksum == 1);
+}
+
+/* ----------------------------------------------------------------------------
+ * draw_frame()
+ *
+ *  Draw a frame into the dynamic plane, moved along by the frame number
+ *
+ *  Param:  Frame kind, frame number
+ *  return: none
+ *
+ */
+static void draw_frame(frame_kind_t kind, int frame)
+{
+    int     step = frame % 256;
+    int     x, y;
+
+    switch ( kind )
+    {
+    case FRAME_SCORE:
+        draw_score(VIDEO_X_RESOLUTION / 4, 50, frame % 100);
+        draw_score((3 * VIDEO_X_RESOLUTION) / 4, 50, (frame / 7) % 100);
+        break;
+
+    case FRAME_PONG:
+        video_fill_rect(0, 0, (VIDEO_X_RESOLUTION - 1), 3, 1, 0);
+        video_fill_rect(0, (VIDEO_Y_RESOLUTION - 4), (VIDEO_X_RESOLUTION - 1), (VIDEO_Y_RESOLUTION - 1), 1, 0);
+
+        for ( y = 8; y < (VIDEO_Y_RESOLUTION - 8); y += 24 )
+            video_fill_rect((VIDEO_X_RESOLUTION / 2) - 2, y, (VIDEO_X_RESOLUTION / 2) + 1, (y + 11), 1, 0);
+
+        y = 8 + step;
+        video_fill_rect(16, y, (16 + PADDLE_COLS - 1), (y + PADDLE_ROWS - 1), 1, 0);
+        y = VIDEO_Y_RESOLUTION - PADDLE_ROWS - 8 - step;
+        video_fill_rect((VIDEO_X_RESOLUTION - 16 - PADDLE_COLS), y, (VIDEO_X_RESOLUTION - 17), (y + PADDLE_ROWS - 1), 1, 0);
+
+        video_bit_blit((40 + 2 * step), (30 + step), &ball);
+
+        draw_score(VIDEO_X_RESOLUTION / 4, 50, frame % 100);
+        draw_score((3 * VIDEO_X_RESOLUTION) / 4, 50, (frame / 7) % 100);
+        break;
+
+    case FRAME_STRESS:
+        for ( int i = 0; i < STRESS_BALLS; i++ )
+        {
+            x = (ball_pos[i][0] + frame) % (VIDEO_X_RESOLUTION - BALL_SIZE);
+            y = (ball_pos[i][1] + frame) % (VIDEO_Y_RESOLUTION - BALL_SIZE);
+            video_bit_blit(x, y, &ball);
+        }
+        break;
+
+    case FRAME_BRICKS:
+        for ( int r = 0; r < BRICK_WALL_ROWS; r++ )
+        {
+            for ( int c = 0; c < BRICK_WALL_COLS; c++ )
+            {
+                x = c * (BRICK_COLS + 2);
+                y = 40 + (r * (BRICK_ROWS + 2));
+                video_fill_rect(x, y, (x + BRICK_COLS - 1), (y + BRICK_ROWS - 1), 1, 0);
+            }
+        }
+        break;
+
+    default:
+        break;
+    }
+}
+
+/* ----------------------------------------------------------------------------
+ * draw_score()
+ *
+ *  Draw a two digit score
+ *
+ *  Param:  Top left corner, score
+ *  return: none
+ *
+ */
+static void draw_score(uint32_t x, uint32_t y, int score)
+{
+    video_bit_blit(x + (score % 3), y, &digit);
+    video_bit_blit((x + DIGIT_COLS + 4), y, &digit);
+}
+
+/* ----------------------------------------------------------------------------
+ * make_bitmaps()
+ *
+ *  A round ball, and a digit '8' drawn with 3 pixel strokes
+ *
+ *  Param:  none
+ *  return: none
+ *
+ */
+static void make_bitmaps(void)
+{
+    int     dx, dy;
+    int     stroke;
+
+    for ( int row = 0; row < BALL_SIZE; row++ )
+    {
+        for ( int col = 0; col < BALL_SIZE; col++ )
+        {
+            dx = (2 * col) - (BALL_SIZE - 1);
+            dy = (2 * row) - (BALL_SIZE - 1);
+            if ( (dx * dx) + (dy * dy) <= (BALL_SIZE * BALL_SIZE) )
+                ball_data[(row * 2) + (col / 8)] |= 0x80 >> (col % 8);
+        }
+    }
+
+    for ( int row = 0; row < DIGIT_ROWS; row++ )
+    {
+        stroke = (row < 3) || (row >= (DIGIT_ROWS / 2) - 1 && row < (DIGIT_ROWS / 2) + 2) || (row >= DIGIT_ROWS - 3);
+
+        for ( int col = 0; col < DIGIT_COLS; col++ )
+        {
+            if ( stroke || col < 3 || col >= (DIGIT_COLS - 3) )
+                digit_data[(row * 2) + (col / 8)] |= 0x80 >> (col % 8);
+        }
+    }
+}
+
+/* ----------------------------------------------------------------------------
+ * plane_bytes()
+ *
+ *  Memory of the dynamic plane
+ *
+ *  Param:  none
+ *  return: Bytes
+ *
+ */
+static uint32_t plane_bytes(void)
+{
+#if (VIDEO_RUN_PLANE == 1)
+    return sizeof(runs) + sizeof(row_head);
+#else
+    return sizeof(dynamic_plane) + sizeof(dynamic_row_used);
+#endif
+}
+
+/* ----------------------------------------------------------------------------
+ * now_ns()
+ *
+ *  Monotonic time stamp
+ *
+ *  Param:  none
+ *  return: Time in nano seconds
+ *
+ */
+static double now_ns(void)
+{
+    struct timespec     ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (ts.tv_sec * 1e9) + ts.tv_nsec;
+}
@@ -0,0 +1,93 @@
+#
+# serial_packets.py
+#
+# Find the binary packets of serial_write_packet() (see serial.c) in the
+# stdio UART output, among text prints. A packet is a 0xA5 sync byte, type,
+# 16 bit little endian payload length, payload, and a checksum that is the
+# 8 bit sum of the type, length and payload bytes. Packets with a bad
+# checksum are dropped and counted.
+#
+
+import sys
+
+SYNC = 0xa5
+HEADER = 4
+MAX_PAYLOAD = 2048
+
+
+class PacketReader:
+    """ Split a byte stream into packets and text lines. """
+
+    def __init__(self, types, text=sys.stdout):
+        self.types = set(types)
+        self.text_out = text
+        self.buf = bytearray()
+        self.text = bytearray()
+        self.bad = 0
+
+    def feed(self, data):
+        """ Add data, and return the complete packets in it as (type, payload). """
+        packets = []
+        self.buf += data
+        pos = 0
+        while pos < len(self.buf):
+            if self.buf[pos] != SYNC:
+                self.text.append(self.buf[pos])
+                pos += 1
+                if self.text[-1:] == b'\n':
+                    self.flush()
+                continue
+
+            if len(self.buf) - pos < HEADER:
+                break
+            kind = self.buf[pos + 1]
+            length = self.buf[pos + 2] | (self.buf[pos + 3] << 8)
+            if kind not in self.types or length > MAX_PAYLOAD:
+                pos += 1
+                self.bad += 1
+                continue
+            if len(self.buf) - pos < HEADER + length + 1:
+                break
+
+            packet = bytes(self.buf[pos:pos + HEADER + length + 1])
+            if sum(packet[1:-1]) & 0xff != packet[-1]:
+                pos += 1
+                self.bad += 1
+                continue
+
+            pos += len(packet)
+            packets.append((kind, packet[HEADER:-1]))
+
+        del self.buf[:pos]
+        return packets
+
+    def flush(self):
+        """ Pass the text received so far. """
+        if self.text and self.text_out:
+            self.text_out.write(self.text.decode('ascii', 'replace'))
+        self.text.clear()
+
+
+def read_source(args, reader, handler):
+    """ Feed a capture file, or a serial port until interrupted, to a packet handler. """
+    try:
+        if args.port:
+            import serial
+            with serial.Serial(args.port, args.baud, timeout=0.1) as port:
+                while True:
+                    for kind, payload in reader.feed(port.read(4096)):
+                        handler(kind, payload)
+        else:
+            with open(args.capture, 'rb') as capture:
+                for kind, payload in reader.feed(capture.read()):
+                    handler(kind, payload)
+    except KeyboardInterrupt:
+        pass
+
+    reader.flush()
+
+
+def add_source_arguments(parser):
+    parser.add_argument('-p', '--port', help='serial port to read instead of a capture file')
+    parser.add_argument('-b', '--baud', type=int, default=115200, help='serial port baud rate')
+    parser.add_argument('capture', nargs='?', help='capture file')
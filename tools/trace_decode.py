@@ -0,0 +1,132 @@
+#!/usr/bin/env python3
+#
+# trace_decode.py
+#
+# Decode the binary event trace (see trace.c) captured from the stdio UART
+# into a CSV file, one row per event, and optionally a trace file in the
+# Chrome trace event format that chrome://tracing and ui.perfetto.dev open.
+# Text that is not part of a packet, such as the telemetry prints, is
+# passed to stdout.
+#
+# Cycle stamps are made continuous across the 32 bit counter wrap, and
+# converted to micro seconds at the CPU clock rate. Records lost in a
+# corrupted packet show as gaps in the record sequence numbers and are
+# counted, records dropped on the device because the ring was full are
+# reported by 'drops' events.
+#
+# Usage: trace_decode.py [-o trace.csv] [-j trace.json] [--mhz 150] <capture file>
+#        trace_decode.py [-o trace.csv] [-j trace.json] -p /dev/ttyACM0 [-b 115200]
+#        (reading a serial port needs pyserial)
+#
+
+import argparse
+import csv
+import json
+import struct
+import sys
+
+from serial_packets import PacketReader, add_source_arguments, read_source
+
+TRACE = ord('T')
+NAME = ord('N')
+OTHER = (ord('F'), ord('L'))    # Frame buffer stream packets, see fbstream_decode.py
+
+RECORD = struct.Struct('<IIHBB')
+
+EVENTS = {1: 'frame', 2: 'task', 3: 'isr', 4: 'bounce', 5: 'score', 6: 'drops'}
+BOUNCES = {0: 'paddle', 1: 'wall', 2: 'edge', 3: 'brick'}
+
+
+class Decoder:
+    """ Trace record decoder. """
+
+    def __init__(self, mhz, writer):
+        self.mhz = mhz
+        self.writer = writer
+        self.tasks = {}
+        self.events = []
+        self.cycles = None
+        self.last = 0
+        self.seq = None
+        self.records = 0
+        self.lost = 0
+
+    def packet(self, kind, payload):
+        if kind == NAME:
+            self.tasks[payload[0]] = payload[1:].decode('ascii', 'replace')
+            return
+        if kind != TRACE:
+            return
+
+        for cycles, value, seq, event, arg in RECORD.iter_unpack(payload):
+            if self.seq is not None:
+                self.lost += (seq - self.seq - 1) & 0xffff
+            self.seq = seq
+
+            # Stamps of records claimed while another was being
+            # recorded can be a little out of order
+            delta = (cycles - self.last) & 0xffffffff
+            if delta >= 0x80000000:
+                delta -= 0x100000000
+            self.cycles = cycles if self.cycles is None else self.cycles + delta
+            self.last = cycles
+            self.records += 1
+
+            name = EVENTS.get(event, 'event%d' % event)
+            if event == 2:
+                detail = self.tasks.get(arg, 'task%d' % arg)
+            elif event == 4:
+                detail = '%s x=%d y=%d' % (BOUNCES.get(arg, arg), value & 0xffff, value >> 16)
+            else:
+                detail = ''
+
+            time_us = self.cycles / self.mhz
+            self.writer.writerow([seq, self.cycles, '%.2f' % time_us, name, arg, value, detail])
+            self.trace(name, detail, time_us, value)
+
+    def trace(self, name, detail, time_us, value):
+        """ Add a Chrome trace event. """
+        if name == 'task':
+            duration = value / self.mhz
+            self.events.append({'name': detail, 'ph': 'X', 'ts': time_us - duration, 'dur': duration,
+                                'pid': 0, 'tid': 0})
+        elif name in ('frame', 'isr'):
+            self.events.append({'name': name + ' us', 'ph': 'C', 'ts': time_us, 'pid': 0,
+                                'args': {'us': value / self.mhz}})
+        elif name in ('score', 'drops'):
+            self.events.append({'name': name, 'ph': 'C', 'ts': time_us, 'pid': 0, 'args': {name: value}})
+        else:
+            self.events.append({'name': detail or name, 'ph': 'i', 's': 't', 'ts': time_us,
+                                'pid': 0, 'tid': 0})
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Decode the binary event trace')
+    parser.add_argument('-o', '--output', default='trace.csv', help='CSV output file, default trace.csv')
+    parser.add_argument('-j', '--json', help='Chrome trace event output file')
+    parser.add_argument('--mhz', type=float, default=150.0, help='CPU clock in MHz, default 150')
+    add_source_arguments(parser)
+    args = parser.parse_args()
+
+    if bool(args.port) == bool(args.capture):
+        parser.error('give a capture file or a serial port')
+
+    reader = PacketReader((TRACE, NAME) + OTHER)
+
+    with open(args.output, 'w', newline='') as csv_file:
+        writer = csv.writer(csv_file)
+        writer.writerow(['seq', 'cycles', 'time_us', 'event', 'arg', 'value', 'detail'])
+        decoder = Decoder(args.mhz, writer)
+        read_source(args, reader, decoder.packet)
+
+    if args.json:
+        with open(args.json, 'w') as json_file:
+            json.dump({'traceEvents': decoder.events}, json_file)
+
+    print('%d records, %d lost, %d bad packets' % (decoder.records, decoder.lost, reader.bad), file=sys.stderr)
+
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,765 @@
+/* video_diff.c
+ *
+ * Host differential test and timing of the drawing primitives
+ *
+ * video.c is compiled into the harness, next to reference implementations
+ * that draw one pixel at a time into a frame buffer of their own. Every
+ * primitive is driven on both with random and edge case inputs: pixel
+ * actions, coordinates on word boundaries, on the screen edges and off
+ * screen, bitmap and image sizes, and short image data. After every call
+ * the whole frame buffer, both planes with their sync words and the dynamic
+ * row flags, is compared with the reference, along with return values.
+ * Then each primitive is timed on both and the speedup is printed.
+ *
+ * The reference pixel semantics:
+ * - CLEAR, SET and FLIP change only the addressed pixel, never
+ *   a neighbour pixel or the sync field of the word.
+ * - Pixels left of or above the screen, and at or beyond VIDEO_X_RESOLUTION
+ *   or VIDEO_Y_RESOLUTION, are not drawn. Line and bitmap coordinates are
+ *   signed, passed as uint32_t.
+ * - Drawing anything but CLEAR into the dynamic plane flags the row for merging,
+ *   and so does writing any pixel of an image, black or white.
+ *
+ * Built with VIDEO_RUN_PLANE=1, the dynamic plane rows are run lists. They
+ * are expanded and compared with the reference pixels instead, and must be
+ * sorted runs that neither overlap nor touch. The row flags are not compared.
+ * Built with VIDEO_TILE_MAP=1, all drawing is into the dynamic plane, and
+ * the reference draws there whatever plane the operation selects.
+ *
+ * Build and run on the host:
+ *   cc -O2 -I tools/host -I include -o video_diff tools/video_diff.c scanline.c
+ *   ./video_diff [seed]
+ * and for the run list dynamic plane, with a pool that random drawing does not empty:
+ *   cc -O2 -I tools/host -I include -DVIDEO_RUN_PLANE=1 -DVIDEO_RUNS=32768 -o video_diff tools/video_diff.c scanline.c
+ * and for the tile map, add -DVIDEO_TILE_MAP=1 to either.
+ *
+ */
+
+#include    <stdio.h>
+#include    <stdlib.h>
+#include    <string.h>
+#include    <time.h>
+
+#include    "../video.c"
+#include    "../runs.c"
+
+/* ----------------------------------------------------------------------------
+ * Module definitions
+ */
+#define     TESTS               20000   // Compared calls per primitive
+#define     TIMED               20000   // Timed calls per primitive
+#define     BITMAPS             64
+#define     IMAGES              32
+#define     IMAGE_DATA_MAX      4096
+
+typedef enum
+{
+    OP_PIXEL,
+    OP_LINE,
+    OP_BLIT,
+    OP_FILL,
+    OP_RLE,
+    OP_COUNT
+} op_kind_t;
+
+typedef struct
+{
+    uint32_t        x0, y0, x1, y1;
+    int             action;         // Pixel action, or fill color
+    int             plane;
+    int             index;          // Bitmap or image
+} op_t;
+
+/* ----------------------------------------------------------------------------
+ * Function prototypes
+ */
+static void     ref_pixel(uint32_t x, uint32_t y);
+static void     ref_line(uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1);
+static void     ref_bit_blit(uint32_t x0, uint32_t y0, const bit_blit_t *bitmap);
+static void     ref_fill_rect(uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1, int color);
+static int      ref_rle_image(uint32_t x0, uint32_t y0, const video_rle_t *image);
+
+static int      run_ref(op_kind_t kind, const op_t *op);
+static int      run_video(op_kind_t kind, const op_t *op);
+static void     make_op(op_kind_t kind, op_t *op, int edge);
+static void     make_bitmaps(void);
+static void     make_images(void);
+static uint32_t coord(uint32_t res, int edge, int negative);
+static void     randomize(void);
+static int      compare(void);
+#if (VIDEO_RUN_PLANE == 1)
+static int      compare_runs(void);
+#endif
+static double   now_ns(void);
+
+/* ----------------------------------------------------------------------------
+ * Module globals
+ */
+static const char  *op_names[OP_COUNT] = { "set_pixel", "line", "bit_blit", "fill_rect", "rle_image" };
+
+static uint32_t         ref_buffer[VIDEO_PLANES][VIDEO_Y_RESOLUTION][SCAN_LINE_BUF_LEN];
+static uint8_t          ref_row_used[VIDEO_Y_RESOLUTION];
+static int              ref_plane = VIDEO_PLANE_STATIC;
+static pixel_action_t   ref_action = SET;
+
+static uint8_t          bitmap_data[BITMAPS][40 * 5];
+static bit_blit_t       bitmaps[BITMAPS];
+static uint8_t          image_data[IMAGES][IMAGE_DATA_MAX];
+static video_rle_t      images[IMAGES];
+
+static op_t             ops[TIMED];
+
+/* Host stand-ins for io.c
+ */
+int io_is_vert_retrace(void)
+{
+    return 1;
+}
+
+uint32_t io_get_cycles(void)
+{
+    return 0;
+}
+
+int io_dma_fill_busy(void)
+{
+    return 0;
+}
+
+void io_dma_fill(uint32_t * const *line_table, uint32_t word_count, uint32_t value, io_callback_t callback)
+{
+    for ( ; *line_table; line_table++ )
+        for ( uint32_t w = 0; w < word_count; w++ )
+            (*line_table)[w] = value;
+
+    if ( callback )
+        callback();
+}
+
+/***************************************************************
+ * main()
+ *
+ */
+int main(int argc, char *argv[])
+{
+    op_t        op;
+    int         failures = 0;
+    int         mismatches;
+    int         result;
+    double      start, ref_ns, video_ns;
+
+    srand(argc > 1 ? atoi(argv[1]) : 1);
+
+    scanline_init();
+    video_init();
+    make_bitmaps();
+    make_images();
+
+    printf("%-10s %8s %11s %10s %10s %8s\n", "primitive", "tests", "mismatches", "ref ns", "video ns", "speedup");
+
+    for ( op_kind_t kind = 0; kind < OP_COUNT; kind++ )
+    {
+        /* Differential test, from a random frame buffer every 64 calls
+         */
+        mismatches = 0;
+
+        for ( int i = 0; i < TESTS; i++ )
+        {
+            if ( (i & 63) == 0 )
+                randomize();
+
+            make_op(kind, &op, (i & 3) == 0);
+
+            result = run_ref(kind, &op);
+
+            if ( result != run_video(kind, &op) || compare() )
+            {
+                if ( mismatches == 0 )
+                    printf("%s: mismatch, (%u,%u)-(%u,%u) action %d plane %d index %d\n",
+                           op_names[kind], op.x0, op.y0, op.x1, op.y1, op.action, op.plane, op.index);
+
+                mismatches++;
+                randomize();
+            }
+        }
+
+        /* Timing, of on screen calls into the static plane
+         */
+        for ( int i = 0; i < TIMED; i++ )
+        {
+            make_op(kind, &ops[i], 0);
+            ops[i].plane = VIDEO_PLANE_STATIC;
+        }
+
+        start = now_ns();
+        for ( int i = 0; i < TIMED; i++ )
+            run_ref(kind, &ops[i]);
+        ref_ns = (now_ns() - start) / TIMED;
+
+        start = now_ns();
+        for ( int i = 0; i < TIMED; i++ )
+            run_video(kind, &ops[i]);
+        video_ns = (now_ns() - start) / TIMED;
+
+        printf("%-10s %8d %11d %10.1f %10.1f %7.2fx\n",
+               op_names[kind], TESTS, mismatches, ref_ns, video_ns, ref_ns / video_ns);
+
+        failures += mismatches;
+    }
+
+    return (failures != 0);
+}
+
+/* ----------------------------------------------------------------------------
+ * ref_pixel()
+ *
+ *  Reference pixel, in the reference plane with the reference action
+ *
+ *  Param:  Pixel coordinate
+ *  return: none
+ *
+ */
+static void ref_pixel(uint32_t x, uint32_t y)
+{
+    uint32_t   *word;
+    uint32_t    bit;
+
+    if ( x >= VIDEO_X_RESOLUTION || y >= VIDEO_Y_RESOLUTION )
+        return;
+
+    word = &ref_buffer[ref_plane][y][(x >> 4) + ACTIVE_VIDEO_OFFSET];
+    bit = 0x80000000 >> (x & 0x0f);
+
+    if ( ref_action == CLEAR )
+        *word &= ~bit;
+    else if ( ref_action == SET )
+        *word |= bit;
+    else
+        *word ^= bit;
+
+    if ( ref_plane == VIDEO_PLANE_DYNAMIC && ref_action != CLEAR )
+        ref_row_used[y] = 1;
+}
+
+/* ----------------------------------------------------------------------------
+ * ref_line()
+ *
+ *  Reference line, Bresenham's line algorithm one pixel at a time
+ *
+ *  Param:  Line start-end (X0,Y0)-(X1,Y1) coordinates
+ *  return: none
+ *
+ */
+static void ref_line(uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1)
+{
+    int64_t     x = (int32_t)x0, y = (int32_t)y0;
+    int64_t     dx, sx;
+    int64_t     dy, sy;
+    int64_t     err, e2;
+
+    dx = llabs((int32_t)x1 - x);
+    sx = x < (int32_t)x1 ? 1 : -1;
+    dy = llabs((int32_t)y1 - y);
+    sy = y < (int32_t)y1 ? 1 : -1;
+    err = (dx > dy ? dx : -dy) / 2;
+
+    for (;;)
+    {
+        ref_pixel(x, y);
+        if ( x == (int32_t)x1 && y == (int32_t)y1 )
+            break;
+        e2 = err;
+        if ( e2 > -dx ) { err -= dy; x += sx; }
+        if ( e2 < dy ) { err += dx; y += sy; }
+    }
+}
+
+/* ----------------------------------------------------------------------------
+ * ref_bit_blit()
+ *
+ *  Reference bit blit, the pixel action on every '1' bit of the bitmap
+ *
+ *  Param:  Top left corner, bitmap
+ *  return: none
+ *
+ */
+static void ref_bit_blit(uint32_t x0, uint32_t y0, const bit_blit_t *bitmap)
+{
+    uint32_t    row_bytes = (bitmap->col_count + 7) / 8;
+
+    for ( uint32_t row = 0; row < bitmap->row_count; row++ )
+        for ( uint32_t col = 0; col < bitmap->col_count; col++ )
+            if ( bitmap->bitmap[row * row_bytes + col / 8] & (0x80 >> (col % 8)) )
+                ref_pixel(x0 + col, y0 + row);
+}
+
+/* ----------------------------------------------------------------------------
+ * ref_fill_rect()
+ *
+ *  Reference rectangle fill, clipped to the screen. In the dynamic
+ *  plane, a filled row is flagged and a full width clear unflags it.
+ *
+ *  Param:  Rectangle corners (X0,Y0)-(X1,Y1) inclusive, color
+ *  return: none
+ *
+ */
+static void ref_fill_rect(uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1, int color)
+{
+    pixel_action_t  action = ref_action;
+
+    if ( x1 >= VIDEO_X_RESOLUTION )
+        x1 = VIDEO_X_RESOLUTION - 1;
+    if ( y1 >= VIDEO_Y_RESOLUTION )
+        y1 = VIDEO_Y_RESOLUTION - 1;
+
+    if ( x0 > x1 || y0 > y1 )
+        return;
+
+    ref_action = color ? SET : CLEAR;
+
+    for ( uint32_t y = y0; y <= y1; y++ )
+    {
+        for ( uint32_t x = x0; x <= x1; x++ )
+            ref_pixel(x, y);
+
+        if ( ref_plane == VIDEO_PLANE_DYNAMIC && !color && x0 == 0 && x1 == (VIDEO_X_RESOLUTION - 1) )
+            ref_row_used[y] = 0;
+    }
+
+    ref_action = action;
+}
+
+/* ----------------------------------------------------------------------------
+ * ref_rle_image()
+ *
+ *  Reference run length encoded image, decoded one pixel at a time
+ *
+ *  Param:  Top left corner, image
+ *  return: 0 if drawn, -1 if the image does not fit or its data is short
+ *
+ */
+static int ref_rle_image(uint32_t x0, uint32_t y0, const video_rle_t *image)
+{
+    pixel_action_t  action = ref_action;
+    uint32_t        pos = 0;
+    uint32_t        pixels = image->col_count * image->row_count;
+    uint32_t        run;
+    int             shift;
+    int             color = 0;
+    int             result = 0;
+
+    x0 &= ~0x0f;
+
+    if ( image->col_count == 0 || image->row_count == 0 ||
+         (x0 + image->col_count) > VIDEO_X_RESOLUTION ||
+         (y0 + image->row_count) > VIDEO_Y_RESOLUTION )
+        return -1;
+
+    for ( uint32_t i = 0; pixels; color ^= 1 )
+    {
+        run = 0;
+        shift = 0;
+
+        do
+        {
+            if ( i == image->size )
+            {
+                result = -1;
+                goto done;
+            }
+
+            run |= (uint32_t)(image->data[i] & 0x7f) << shift;
+            shift += 7;
+        }
+        while ( image->data[i++] & 0x80 );
+
+        ref_action = color ? SET : CLEAR;
+
+        for ( ; run && pixels; run--, pixels--, pos++ )
+        {
+            ref_pixel(x0 + (pos % image->col_count), y0 + (pos / image->col_count));
+
+            if ( ref_plane == VIDEO_PLANE_DYNAMIC )
+                ref_row_used[y0 + (pos / image->col_count)] = 1;
+        }
+    }
+
+done:
+    ref_action = action;
+
+    return result;
+}
+
+/* ----------------------------------------------------------------------------
+ * run_ref()
+ *
+ *  Run an operation on the reference
+ *
+ *  Param:  Operation kind and parameters
+ *  return: Return value of the primitive, 0 if it has none
+ *
+ */
+static int run_ref(op_kind_t kind, const op_t *op)
+{
+    ref_plane = VIDEO_TILE_MAP ? VIDEO_PLANE_DYNAMIC : op->plane;
+    ref_action = op->action;
+
+    switch ( kind )
+    {
+    case OP_PIXEL:
+        ref_pixel(op->x0, op->y0);
+        break;
+
+    case OP_LINE:
+        ref_line(op->x0, op->y0, op->x1, op->y1);
+        break;
+
+    case OP_BLIT:
+        ref_bit_blit(op->x0, op->y0, &bitmaps[op->index]);
+        break;
+
+    case OP_FILL:
+        ref_action = SET;
+        ref_fill_rect(op->x0, op->y0, op->x1, op->y1, op->action);
+        break;
+
+    case OP_RLE:
+        return ref_rle_image(op->x0, op->y0, &images[op->index]);
+
+    default:
+        break;
+    }
+
+    return 0;
+}
+
+/* ----------------------------------------------------------------------------
+ * run_video()
+ *
+ *  Run an operation on video.c
+ *
+ *  Param:  Operation kind and parameters
+ *  return: Return value of the primitive, 0 if it has none
+ *
+ */
+static int run_video(op_kind_t kind, const op_t *op)
+{
+    video_set_plane(op->plane);
+    video_set_default_action(op->action);
+
+    switch ( kind )
+    {
+    case OP_PIXEL:
+        video_set_pixel(op->x0, op->y0);
+        break;
+
+    case OP_LINE:
+        video_line(op->x0, op->y0, op->x1, op->y1);
+        break;
+
+    case OP_BLIT:
+        video_bit_blit(op->x0, op->y0, &bitmaps[op->index]);
+        break;
+
+    case OP_FILL:
+        video_set_default_action(SET);
+        video_fill_rect(op->x0, op->y0, op->x1, op->y1, op->action, 0);
+        break;
+
+    case OP_RLE:
+        return video_rle_image(op->x0, op->y0, &images[op->index]);
+
+    default:
+        break;
+    }
+
+    return 0;
+}
+
+/* ----------------------------------------------------------------------------
+ * make_op()
+ *
+ *  Make random operation parameters
+ *
+ *  Param:  Operation kind, parameters, edge case coordinates
+ *  return: none
+ *
+ */
+static void make_op(op_kind_t kind, op_t *op, int edge)
+{
+    int     negative = (kind == OP_BLIT || kind == OP_LINE);
+
+    op->x0 = coord(VIDEO_X_RESOLUTION, edge, negative);
+    op->y0 = coord(VIDEO_Y_RESOLUTION, edge, negative);
+    op->x1 = coord(VIDEO_X_RESOLUTION, edge, kind == OP_LINE);
+    op->y1 = coord(VIDEO_Y_RESOLUTION, edge, kind == OP_LINE);
+    op->action = rand() % 3;
+    op->plane = rand() % VIDEO_PLANES;
+    op->index = 0;
+
+    switch ( kind )
+    {
+    case OP_LINE:
+        /* Mostly short lines, as drawn by the game
+         */
+        if ( !edge && (rand() & 1) )
+        {
+            op->x1 = op->x0 + (rand() % 64);
+            op->y1 = op->y0 + (rand() % 64);
+        }
+        break;
+
+    case OP_BLIT:
+        op->index = rand() % BITMAPS;
+        break;
+
+    case OP_FILL:
+        op->action = rand() & 1;
+        if ( !edge && (rand() & 1) )
+        {
+            op->x0 = rand() % VIDEO_X_RESOLUTION;
+            op->x1 = op->x0 + (rand() % 80);
+            op->y1 = op->y0 + (rand() % 40);
+        }
+        break;
+
+    case OP_RLE:
+        op->index = rand() % IMAGES;
+        if ( !edge )
+        {
+            op->x0 = rand() % (VIDEO_X_RESOLUTION - images[op->index].col_count + 1);
+            op->y0 = rand() % (VIDEO_Y_RESOLUTION - images[op->index].row_count + 1);
+        }
+        break;
+
+    default:
+        break;
+    }
+}
+
+/* ----------------------------------------------------------------------------
+ * make_bitmaps()
+ *
+ *  Random bitmaps of 0 to 40 by 0 to 40 pixels
+ *
+ *  Param:  none
+ *  return: none
+ *
+ */
+static void make_bitmaps(void)
+{
+    for ( int i = 0; i < BITMAPS; i++ )
+    {
+        bitmaps[i].bitmap = bitmap_data[i];
+        bitmaps[i].col_count = (i == 0) ? 0 : (i < 8) ? i : 1 + rand() % 40;
+        bitmaps[i].row_count = (i == 1) ? 0 : 1 + rand() % 40;
+
+        for ( size_t b = 0; b < sizeof(bitmap_data[i]); b++ )
+            bitmap_data[i][b] = (i & 1) ? 0xff : rand();
+    }
+}
+
+/* ----------------------------------------------------------------------------
+ * make_images()
+ *
+ *  Random run length encoded images, some with short data
+ *
+ *  Param:  none
+ *  return: none
+ *
+ */
+static void make_images(void)
+{
+    uint32_t    pixels, run;
+    uint32_t    size;
+
+    for ( int i = 0; i < IMAGES; i++ )
+    {
+        images[i].data = image_data[i];
+        images[i].col_count = 1 + rand() % 100;
+        images[i].row_count = 1 + rand() % 30;
+
+        pixels = images[i].col_count * images[i].row_count;
+        size = 0;
+
+        /* Mostly short runs, some long and some of zero length
+         */
+        while ( pixels && size < (IMAGE_DATA_MAX - 5) )
+        {
+            run = (rand() % 4) ? rand() % 20 : rand() % 600;
+            if ( run > pixels )
+                run = pixels;
+            pixels -= run;
+
+            for ( ; run >= 0x80; run >>= 7 )
+                image_data[i][size++] = (run & 0x7f) | 0x80;
+            image_data[i][size++] = run;
+        }
+
+        images[i].size = (i % 4 == 3) ? size / 2 : size;
+    }
+}
+
+/* ----------------------------------------------------------------------------
+ * coord()
+ *
+ *  Random coordinate
+ *
+ *  Param:  Resolution, edge case, negative coordinates left of or above the screen
+ *  return: Coordinate
+ *
+ */
+static uint32_t coord(uint32_t res, int edge, int negative)
+{
+    const uint32_t  edges[] = { 0, 1, 15, 16, 17, res - 17, res - 16, res - 1, res, res + 1, res + 15, 2 * res,
+                                VIDEO_LINE_COORD_MAX, (uint32_t)-VIDEO_LINE_COORD_MAX };
+
+    if ( !edge )
+        return rand() % res;
+
+    if ( negative && (rand() & 1) )
+        return (uint32_t)-(1 + rand() % ((rand() & 3) ? 48 : 4096));
+
+    if ( rand() & 1 )
+        return edges[rand() % (sizeof(edges) / sizeof(edges[0]))];
+
+    return rand() % (2 * res);
+}
+
+/* ----------------------------------------------------------------------------
+ * randomize()
+ *
+ *  Fill the pixel fields of both planes with random pixels,
+ *  and copy the frame buffer to the reference
+ *
+ *  Param:  none
+ *  return: none
+ *
+ */
+static void randomize(void)
+{
+    uint32_t    x;
+
+#if (VIDEO_TILE_MAP == 0)
+    for ( int y = 0; y < VIDEO_Y_RESOLUTION; y++ )
+        for ( int w = ACTIVE_VIDEO_OFFSET; w < (ACTIVE_VIDEO_OFFSET + VIDEO_ACTIVE_WORDS); w++ )
+            static_plane[y][w] = (static_plane[y][w] & ~PIXEL_FIELD_MASK) | ((uint32_t)rand() << 16);
+
+    memcpy(ref_buffer[VIDEO_PLANE_STATIC], static_plane, sizeof(static_plane));
+#endif
+
+#if (VIDEO_RUN_PLANE == 0)
+    for ( int y = 0; y < VIDEO_Y_RESOLUTION; y++ )
+        for ( int w = ACTIVE_VIDEO_OFFSET; w < (ACTIVE_VIDEO_OFFSET + VIDEO_ACTIVE_WORDS); w++ )
+            dynamic_plane[y][w] = (dynamic_plane[y][w] & ~PIXEL_FIELD_MASK) | ((uint32_t)rand() << 16);
+
+    memcpy(ref_buffer[VIDEO_PLANE_DYNAMIC], dynamic_plane, sizeof(dynamic_plane));
+#endif
+
+    for ( int y = 0; y < VIDEO_Y_RESOLUTION; y++ )
+        dynamic_row_used[y] = rand() & 1;
+
+    memcpy(ref_row_used, dynamic_row_used, sizeof(ref_row_used));
+
+    /* A few random runs in each dynamic plane row
+     */
+    if ( VIDEO_RUN_PLANE )
+    {
+        runs_init();
+        memset(ref_buffer[VIDEO_PLANE_DYNAMIC], 0, sizeof(ref_buffer[VIDEO_PLANE_DYNAMIC]));
+
+        for ( int y = 0; y < VIDEO_Y_RESOLUTION; y++ )
+        {
+            for ( int i = rand() % 4; i > 0; i-- )
+            {
+                x = rand() % VIDEO_X_RESOLUTION;
+                runs_span(y, x, x + 1 + (rand() % 64), SET);
+            }
+
+            runs_expand(y, ref_buffer[VIDEO_PLANE_DYNAMIC][y]);
+        }
+    }
+}
+
+/* ----------------------------------------------------------------------------
+ * compare()
+ *
+ *  Compare the frame buffer with the reference
+ *
+ *  Param:  none
+ *  return: 0 if identical
+ *
+ */
+static int compare(void)
+{
+#if (VIDEO_TILE_MAP == 0)
+    if ( memcmp(ref_buffer[VIDEO_PLANE_STATIC], static_plane, sizeof(static_plane)) )
+        return 1;
+#endif
+
+#if (VIDEO_RUN_PLANE == 1)
+    return compare_runs();
+#else
+    return memcmp(ref_buffer[VIDEO_PLANE_DYNAMIC], dynamic_plane, sizeof(dynamic_plane)) ||
+           memcmp(ref_row_used, dynamic_row_used, sizeof(ref_row_used));
+#endif
+}
+
+#if (VIDEO_RUN_PLANE == 1)
+/* ----------------------------------------------------------------------------
+ * compare_runs()
+ *
+ *  Compare the expanded dynamic plane run lists with the reference
+ *  dynamic plane, and check that the lists are well formed
+ *
+ *  Param:  none
+ *  return: 0 if identical and well formed
+ *
+ */
+static int compare_runs(void)
+{
+    uint32_t        line[SCAN_LINE_BUF_LEN];
+    uint32_t        count = 0;
+    runs_stats_t    run_stats;
+
+    for ( int y = 0; y < VIDEO_Y_RESOLUTION; y++ )
+    {
+        memset(line, 0, sizeof(line));
+        runs_expand(y, line);
+
+        if ( memcmp(&line[ACTIVE_VIDEO_OFFSET], &ref_buffer[VIDEO_PLANE_DYNAMIC][y][ACTIVE_VIDEO_OFFSET],
+                    VIDEO_ACTIVE_WORDS * sizeof(uint32_t)) )
+            return 1;
+
+        for ( uint16_t n = row_head[y]; n != RUN_NONE; n = runs[n].next, count++ )
+        {
+            if ( runs[n].start >= runs[n].end || runs[n].end > VIDEO_X_RESOLUTION )
+                return 1;
+            if ( runs[n].next != RUN_NONE && runs[runs[n].next].start <= runs[n].end )
+                return 1;
+        }
+    }
+
+    runs_get_stats(&run_stats);
+
+    return (count != run_stats.used || run_stats.drops != 0);
+}
+#endif
+
+/* ----------------------------------------------------------------------------
+ * now_ns()
+ *
+ *  Monotonic time stamp
+ *
+ *  Param:  none
+ *  return: Time in nano seconds
+ *
+ */
+static double now_ns(void)
+{
+    struct timespec     ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (ts.tv_sec * 1e9) + ts.tv_nsec;
+}
@@ -0,0 +1,197 @@
+/* trace.c
+ *
+ * Binary event trace
+ *
+ * Events are recorded into a ring of fixed size records stamped with the
+ * CPU cycle counter, and a background task drains the ring into the UART
+ * transmit queue, which DMA sends. Recording does not format or copy
+ * strings and takes a few dozen cycles, so it can be used in the game
+ * tasks and in interrupt handlers.
+ *
+ * The ring is lock-free. A writer claims a slot by advancing the head
+ * index with compare-and-swap, fills the slot, and then commits it by
+ * storing its index in the slot's commit word. The reader copies
+ * committed slots in order and then advances the tail, and stops at a
+ * slot that is claimed but not yet committed, such as one claimed by
+ * code that an interrupt preempted. When the ring is full the record is
+ * dropped and counted, the writer never waits.
+ *
+ * Records are sent in packets framed by serial_write_packet(),
+ * and tools/trace_decode.py turns them into CSV or trace files.
+ *
+ */
+
+#include    <stdatomic.h>
+#include    <string.h>
+
+#include    "pico.h"
+#include    "hardware/structs/m33.h"
+
+#include    "trace.h"
+#include    "serial.h"
+
+/* ----------------------------------------------------------------------------
+ * Module definitions
+ */
+#define     TRACE_MASK              (TRACE_RECORDS - 1)
+#define     RECORDS_PER_PACKET      64
+
+/* ----------------------------------------------------------------------------
+ * Function prototypes
+ */
+
+/* ----------------------------------------------------------------------------
+ * Module globals
+ */
+static trace_record_t       ring[TRACE_RECORDS];
+static atomic_uint_fast32_t commit[TRACE_RECORDS];  // Index + 1 of the record in the slot
+static atomic_uint_fast32_t head = 0;               // Free running index of the next slot to claim
+static atomic_uint_fast32_t tail = 0;               // Free running index of the next record to send
+static atomic_uint_fast32_t drops = 0;
+static uint32_t             drops_sent = 0;
+static trace_record_t       packet[RECORDS_PER_PACKET];
+
+/***************************************************************
+ * trace_init()
+ *
+ *  Initialize the event ring. Call after serial_init().
+ *
+ *  Param:  none
+ *  return: none
+ *
+ */
+void trace_init(void)
+{
+    for ( int i = 0; i < TRACE_RECORDS; i++ )
+        atomic_init(&commit[i], 0);
+
+    atomic_store(&head, 0);
+    atomic_store(&tail, 0);
+    atomic_store(&drops, 0);
+    drops_sent = 0;
+}
+
+/***************************************************************
+ * trace_record()
+ *
+ *  Record an event, safe to call from any context
+ *  including interrupt handlers.
+ *
+ *  Param:  Event ID, event argument and value
+ *  return: none
+ *
+ */
+void __not_in_flash_func(trace_record)(trace_id_t id, uint8_t arg, uint32_t value)
+{
+    uint_fast32_t   index;
+    trace_record_t *record;
+
+    index = atomic_load_explicit(&head, memory_order_relaxed);
+
+    do
+    {
+        if ( (index - atomic_load_explicit(&tail, memory_order_acquire)) >= TRACE_RECORDS )
+        {
+            atomic_fetch_add_explicit(&drops, 1, memory_order_relaxed);
+            return;
+        }
+    }
+    while ( !atomic_compare_exchange_weak_explicit(&head, &index, index + 1,
+                                                   memory_order_relaxed, memory_order_relaxed) );
+
+    record = &ring[index & TRACE_MASK];
+    record->cycles = m33_hw->dwt_cyccnt;
+    record->value = value;
+    record->seq = index;
+    record->id = id;
+    record->arg = arg;
+
+    atomic_store_explicit(&commit[index & TRACE_MASK], index + 1, memory_order_release);
+}
+
+/***************************************************************
+ * trace_name()
+ *
+ *  Send the name of a task index, so the host tool
+ *  can label task events. Sent directly, not through the ring.
+ *
+ *  Param:  Task index and its name
+ *  return: none
+ *
+ */
+void trace_name(uint8_t arg, const char *name)
+{
+    uint8_t     payload[32];
+    uint32_t    len;
+
+    len = strlen(name);
+    if ( len > (sizeof(payload) - 1) )
+        len = sizeof(payload) - 1;
+
+    payload[0] = arg;
+    memcpy(&payload[1], name, len);
+
+    serial_write_packet(TRACE_NAME_PACKET, payload, len + 1);
+}
+
+/***************************************************************
+ * trace_drain()
+ *
+ *  Queue the committed records for transmit,
+ *  run as a background task once per tick.
+ *  Records that do not fit in the transmit queue
+ *  stay in the ring for the next run.
+ *
+ *  Param:  none
+ *  return: none
+ *
+ */
+void trace_drain(void)
+{
+    uint_fast32_t   index;
+    uint32_t        total_drops;
+    int             count;
+
+    /* Report drops as an event of their own
+     */
+    total_drops = atomic_load_explicit(&drops, memory_order_relaxed);
+    if ( total_drops != drops_sent )
+    {
+        trace_record(TRACE_DROPS, 0, total_drops);
+        drops_sent = total_drops;
+    }
+
+    index = atomic_load_explicit(&tail, memory_order_relaxed);
+
+    do
+    {
+        for ( count = 0; count < RECORDS_PER_PACKET; count++ )
+        {
+            if ( atomic_load_explicit(&commit[(index + count) & TRACE_MASK], memory_order_acquire) != (index + count + 1) )
+                break;
+
+            packet[count] = ring[(index + count) & TRACE_MASK];
+        }
+
+        if ( count == 0 || !serial_write_packet(TRACE_PACKET, packet, count * sizeof(trace_record_t)) )
+            break;
+
+        index += count;
+        atomic_store_explicit(&tail, index, memory_order_release);
+    }
+    while ( count == RECORDS_PER_PACKET );
+}
+
+/***************************************************************
+ * trace_get_drops()
+ *
+ *  Return the number of records dropped because the ring was full
+ *
+ *  Param:  none
+ *  return: Dropped records
+ *
+ */
+uint32_t trace_get_drops(void)
+{
+    return atomic_load(&drops);
+}
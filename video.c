@@ -8,44 +8,312 @@
 #include    <stdlib.h>
 #include    <string.h>
 
+#include    "pico.h"
+
 #include    "scanline.h"
 #include    "video.h"
+#include    "runs.h"
 #include    "io.h"
 
+/* ----------------------------------------------------------------------------
+ * Module definitions
+ */
+#define     PIXEL_FIELD_MASK    0xffff0000
+
+#define     TILE_COLS           (VIDEO_X_RESOLUTION / VIDEO_TILE_SIZE)
+#define     TILE_ROWS           ((VIDEO_Y_RESOLUTION + VIDEO_TILE_SIZE - 1) / VIDEO_TILE_SIZE)
+
+typedef struct
+{
+    const uint32_t     *bits;       // Image rows in RAM, first pixel in the MSB
+    const uint32_t     *mask;       // Mask rows in RAM, NULL for a transparent sprite
+    uint32_t            row_count;
+    int                 x, y;       // Top left corner, may be off screen
+    uint8_t             priority;
+    uint8_t             enabled;
+} sprite_t;
+
+/* ----------------------------------------------------------------------------
+ * Function prototypes
+ */
+static uint32_t video_sprite_row(const uint8_t *data, uint32_t col_count);
+static void     video_merge_sprite(uint32_t *line, const sprite_t *sprite, int row);
+static int32_t  video_line_clip(int32_t a0, int32_t sa, int32_t da, int32_t res_a,
+                                int32_t b0, int32_t sb, int32_t db, int32_t res_b,
+                                int32_t *first, int32_t *minor);
+static inline void video_step_x(uint32_t **word, uint32_t *bit, int32_t sx);
+static inline void video_action_masks(uint32_t *clear, uint32_t *toggle);
+#if (VIDEO_RUN_PLANE == 1)
+static void     video_line_runs(int32_t x, int32_t y, int32_t dx, int32_t sx, int32_t dy, int32_t sy,
+                                int32_t err, int32_t count);
+static void     video_blit_runs(uint32_t x, uint32_t y, const uint8_t *data, uint32_t col_first, uint32_t col_end);
+#endif
+#if (VIDEO_TILE_MAP == 1)
+static void     video_tile_row(uint32_t row, uint32_t *line);
+#endif
+static uint32_t* video_claim_line(const uint32_t *line);
+
+/* ----------------------------------------------------------------------------
+ * Module globals
+ */
+
 /* Active pixels start at the 7th DWORD.
  * 16 MSBs in each DWORD, 40 DWORDs in a line.
  */
 static int              initialized = 0;
 static pixel_action_t   pixel_action = SET;
 
-static uint32_t video_buffer[VIDEO_Y_RESOLUTION][SCAN_LINE_BUF_LEN];
+/* The frame buffer planes are in main SRAM, which is striped across the SRAM banks
+ * one word at a time, so scanout DMA reading one row and CPU drawing into another
+ * row spread their accesses over all banks instead of queuing on one.
+ * Both planes have the scan line layout, only the static plane has sync words.
+ * A dynamic plane row is merged at scanout only after something was drawn in it.
+ * With VIDEO_RUN_PLANE the dynamic plane is not a bitmap, its rows are lists
+ * of white pixel runs that are expanded into the line buffer at scanout.
+ * With VIDEO_TILE_MAP the static plane is the tile map, and all drawing
+ * goes to the dynamic plane, which is an overlay on the tiles.
+ */
+#if (VIDEO_TILE_MAP == 0)
+static uint32_t static_plane[VIDEO_Y_RESOLUTION][SCAN_LINE_BUF_LEN];
+#endif
+#if (VIDEO_RUN_PLANE == 0)
+static uint32_t dynamic_plane[VIDEO_Y_RESOLUTION][SCAN_LINE_BUF_LEN];
+#endif
+static uint8_t  dynamic_row_used[VIDEO_Y_RESOLUTION];
+#if (VIDEO_TILE_MAP == 0)
+static uint32_t (*draw_plane)[SCAN_LINE_BUF_LEN] = static_plane;
+static int      draw_plane_dynamic = 0;
+#elif (VIDEO_RUN_PLANE == 0)
+static uint32_t (*draw_plane)[SCAN_LINE_BUF_LEN] = dynamic_plane;
+static int      draw_plane_dynamic = 1;
+#else
+static uint32_t (*draw_plane)[SCAN_LINE_BUF_LEN] = NULL;   // All drawing is into the run lists
+static int      draw_plane_dynamic = 1;
+#endif
+static uint32_t *fill_lines[VIDEO_Y_RESOLUTION + 1];    // DMA fill line table, NULL terminated
+
+#if (VIDEO_TILE_MAP == 1)
+/* Tile map, a byte per 8x8 pixel cell that selects a tile from the tile set.
+ * The tile set is copied to RAM, scanout reads it on every line and a flash
+ * read that misses the XIP cache would stall the scan line interrupt.
+ * The map starts as all tile 0 of a blank set.
+ */
+static uint8_t          tile_map[TILE_ROWS][TILE_COLS];
+static uint8_t          tile_data[VIDEO_TILES * VIDEO_TILE_SIZE];
+static uint32_t         tile_count = 1;
+#endif
+
+/* Sprite table, and the enabled sprites in priority order latched
+ * at the start of every field, so a sprite does not move mid-field.
+ * Sprite images are copied to RAM rows, so scanout does not read flash.
+ * Scan lines with sprites are composed into alternating line buffers,
+ * one is read by scanout DMA while the next line is composed into the other.
+ */
+static sprite_t             sprites[VIDEO_SPRITES];
+static uint32_t             sprite_bits[VIDEO_SPRITES][VIDEO_SPRITE_MAX_ROWS];
+static uint32_t             sprite_mask[VIDEO_SPRITES][VIDEO_SPRITE_MAX_ROWS];
+static sprite_t             field_sprites[VIDEO_SPRITES];
+static int                  field_sprite_count = 0;
+static uint32_t             line_buffer[2][SCAN_LINE_BUF_LEN];
+static int                  line_buffer_index = 0;
+static video_line_stats_t   line_stats;
+
+/* Row table, the frame buffer row shown on each display row, and a row
+ * offset added to all of them that is latched at the start of every field.
+ * Scrolling, split screens, line repetition and shaking rewrite the
+ * table or the offset, no pixels are moved.
+ */
+static uint16_t             row_table[VIDEO_Y_RESOLUTION];
+static uint32_t             row_offset = 0;
+static uint32_t             field_row_offset = 0;
 
 /***************************************************************
- * video_get_even_field()
+ * video_begin_field()
  * 
- *  Return pointer to first even scan line
+ *  Latch the enabled sprites in priority order, and the row offset, for the next field.
+ *  Called from the scan line interrupt before the first active line.
  * 
  *  Param:  none
- *  return: Scan line pointer
+ *  return: none
  * 
  */
-uint32_t* video_get_even_field(void)
+void __not_in_flash_func(video_begin_field)(void)
 {
-    return  &video_buffer[1][0];
+    int     count = 0;
+    int     j;
+
+    for ( int i = 0; i < VIDEO_SPRITES; i++ )
+    {
+        if ( !sprites[i].enabled )
+            continue;
+
+        for ( j = count; j > 0 && field_sprites[j - 1].priority > sprites[i].priority; j-- )
+            field_sprites[j] = field_sprites[j - 1];
+
+        field_sprites[j] = sprites[i];
+        count++;
+    }
+
+    field_sprite_count = count;
+    field_row_offset = row_offset;
 }
 
 /***************************************************************
- * video_get_odd_field()
+ * video_scan_line()
  * 
- *  Return pointer to first odd scan line
+ *  Return the scan line to send to HSTX for a display row, from the frame
+ *  buffer row the row table maps it to.
+ *  Rows with only static plane content are sent straight from the frame buffer,
+ *  rows with dynamic plane content or sprites are composed into a line buffer.
+ *  With VIDEO_TILE_MAP every row is composed, from its tiles.
+ *  Called from the scan line interrupt one line ahead of scanout.
  * 
- *  Param:  none
+ *  Param:  Display row
  *  return: Scan line pointer
  * 
  */
-uint32_t* video_get_odd_field(void)
+uint32_t* __not_in_flash_func(video_scan_line)(uint32_t display_row)
+{
+    uint32_t    row;
+    uint32_t    start;
+    uint32_t    cycles;
+    uint32_t   *line;
+#if (VIDEO_RUN_PLANE == 0)
+    uint32_t   *dynamic;
+    uint32_t   *compose;
+#endif
+    int         sprite_row;
+    int         composed = 0;
+    uint32_t    count = 0;
+
+    start = io_get_cycles();
+
+    row = row_table[display_row] + field_row_offset;
+    if ( row >= VIDEO_Y_RESOLUTION )
+        row -= VIDEO_Y_RESOLUTION;
+
+#if (VIDEO_TILE_MAP == 1)
+    /* Every row is composed, starting from its tiles
+     */
+    line = &line_buffer[line_buffer_index][0];
+    line_buffer_index ^= 1;
+    composed = 1;
+
+    video_tile_row(row, line);
+#else
+    line = &static_plane[row][0];
+#endif
+
+#if (VIDEO_RUN_PLANE == 1)
+    if ( runs_row_used(row) )
+    {
+        if ( !composed )
+        {
+            line = video_claim_line(line);
+            composed = 1;
+        }
+
+        runs_expand(row, line);
+    }
+#else
+    if ( dynamic_row_used[row] )
+    {
+        dynamic = &dynamic_plane[row][0];
+        compose = composed ? line : &line_buffer[line_buffer_index][0];
+
+        for ( int w = ACTIVE_VIDEO_OFFSET; w < (ACTIVE_VIDEO_OFFSET + VIDEO_ACTIVE_WORDS); w++ )
+            compose[w] = line[w] | dynamic[w];
+
+        if ( !composed )
+        {
+            line = compose;
+            line_buffer_index ^= 1;
+            composed = 1;
+        }
+    }
+#endif
+
+    for ( int i = 0; i < field_sprite_count; i++ )
+    {
+        sprite_row = (int)row - field_sprites[i].y;
+        if ( sprite_row < 0 || sprite_row >= (int)field_sprites[i].row_count )
+            continue;
+
+        if ( !composed )
+        {
+            line = video_claim_line(line);
+            composed = 1;
+        }
+
+        video_merge_sprite(line, &field_sprites[i], sprite_row);
+        count++;
+    }
+
+    cycles = io_get_cycles() - start;
+
+    if ( cycles > line_stats.max_cycles )
+        line_stats.max_cycles = cycles;
+    if ( count > line_stats.max_sprites )
+        line_stats.max_sprites = count;
+
+    return line;
+}
+
+/***************************************************************
+ * video_read_line()
+ * 
+ *  Compose a display row as it is shown on screen, from the frame buffer
+ *  row the row table maps it to, both planes and the sprites of the current
+ *  field, into a line buffer. Only the active video words are written.
+ * 
+ *  Param:  Display row, line buffer of SCAN_LINE_BUF_LEN words
+ *  return: Pointer to the first active video word in the line buffer
+ * 
+ */
+uint32_t* __not_in_flash_func(video_read_line)(uint32_t display_row, uint32_t *line)
 {
-    return  &video_buffer[0][0];
+    uint32_t    row;
+#if (VIDEO_RUN_PLANE == 0)
+    uint32_t   *dynamic_row;
+#endif
+    int         sprite_row;
+
+    if ( display_row >= VIDEO_Y_RESOLUTION )
+        display_row = VIDEO_Y_RESOLUTION - 1;
+
+    row = row_table[display_row] + field_row_offset;
+    if ( row >= VIDEO_Y_RESOLUTION )
+        row -= VIDEO_Y_RESOLUTION;
+
+#if (VIDEO_TILE_MAP == 1)
+    video_tile_row(row, line);
+#else
+    for ( int w = ACTIVE_VIDEO_OFFSET; w < (ACTIVE_VIDEO_OFFSET + VIDEO_ACTIVE_WORDS); w++ )
+        line[w] = static_plane[row][w];
+#endif
+
+#if (VIDEO_RUN_PLANE == 1)
+    runs_expand(row, line);
+#else
+    dynamic_row = &dynamic_plane[row][0];
+
+    if ( dynamic_row_used[row] )
+    {
+        for ( int w = ACTIVE_VIDEO_OFFSET; w < (ACTIVE_VIDEO_OFFSET + VIDEO_ACTIVE_WORDS); w++ )
+            line[w] |= dynamic_row[w];
+    }
+#endif
+
+    for ( int i = 0; i < field_sprite_count; i++ )
+    {
+        sprite_row = (int)row - field_sprites[i].y;
+        if ( sprite_row < 0 || sprite_row >= (int)field_sprites[i].row_count )
+            continue;
+
+        video_merge_sprite(line, &field_sprites[i], sprite_row);
+    }
+
+    return &line[ACTIVE_VIDEO_OFFSET];
 }
 
 /***************************************************************
@@ -61,20 +329,73 @@ void video_init(void)
 {
     int         i;
 
-    memset(video_buffer, 0, sizeof(video_buffer));
+#if (VIDEO_TILE_MAP == 1)
+    memset(tile_map, 0, sizeof(tile_map));
+    memset(tile_data, 0, sizeof(tile_data));
+    tile_count = 1;
+#else
+    memset(static_plane, 0, sizeof(static_plane));
 
     for ( i = 0; i < VIDEO_Y_RESOLUTION; i++ )
     {
-        memcpy(&video_buffer[i][0], vid_blank_scan_line, (ACTIVE_VIDEO_OFFSET * sizeof(uint32_t)));
+        scanline_active_init(&static_plane[i][0]);
+    }
+#endif
+
+#if (VIDEO_RUN_PLANE == 0)
+    memset(dynamic_plane, 0, sizeof(dynamic_plane));
+#endif
+    memset(dynamic_row_used, 0, sizeof(dynamic_row_used));
+
+    memset(line_buffer, 0, sizeof(line_buffer));
+
+    for ( i = 0; i < 2; i++ )
+    {
+        scanline_active_init(&line_buffer[i][0]);
     }
 
+#if (VIDEO_RUN_PLANE == 1)
+    runs_init();
+#endif
+
+    video_reset_rows();
+
     initialized = 1;
 }
 
+/***************************************************************
+ * video_set_plane()
+ * 
+ *  Select the frame buffer plane for drawing functions.
+ *  The static plane is for content drawn once, the dynamic plane
+ *  can be cleared and redrawn without touching static content.
+ *  The planes are ORed at scanout. With VIDEO_TILE_MAP the static plane
+ *  is drawn with the tile functions, and drawing is always into the
+ *  dynamic plane.
+ * 
+ *  Param:  Plane
+ *  return: none
+ * 
+ */
+void video_set_plane(video_plane_t plane)
+{
+#if (VIDEO_TILE_MAP == 1)
+    (void)plane;                                // The static plane is the tile map
+#else
+    draw_plane_dynamic = (plane == VIDEO_PLANE_DYNAMIC);
+#if (VIDEO_RUN_PLANE == 1)
+    draw_plane = static_plane;                  // Dynamic plane drawing goes to the run lists
+#else
+    draw_plane = draw_plane_dynamic ? dynamic_plane : static_plane;
+#endif
+#endif
+}
+
 /***************************************************************
  * video_clear_screen()
  * 
- *  Clear video screen to color (1-white, 0-black)
+ *  Clear the drawing plane to color (1-white, 0-black)
+ *  The clear is done by DMA, and the function returns when it completes.
  * 
  *  Param:  1-white, 0-black
  *  return: none
@@ -82,17 +403,172 @@ void video_init(void)
  */
 void video_clear_screen(int color)
 {
-    int         i, j;
+    if ( !initialized )
+        return;
+
+    video_fill_rect(0, 0, (VIDEO_X_RESOLUTION - 1), (VIDEO_Y_RESOLUTION - 1), color, 0);
+    video_fill_wait();
+}
+
+/***************************************************************
+ * video_fill_rect()
+ * 
+ *  Fill a rectangle with color (1-white, 0-black).
+ *  Whole 16-pixel words are filled by DMA in the background,
+ *  partial words at the rectangle's left and right edges are
+ *  filled by the CPU before the function returns.
+ *  Do not draw into the rectangle until the fill completes.
+ *  The rectangle is clipped to the screen.
+ * 
+ *  Param:  Rectangle corners (X0,Y0)-(X1,Y1) inclusive, color,
+ *          and optional callback called from an IRQ when DMA fill completes.
+ *  return: none
+ * 
+ */
+void __not_in_flash_func(video_fill_rect)(uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1, int color, video_callback_t callback)
+{
+    uint32_t    first_word, last_word;
+    uint32_t    left_mask = 0, right_mask = 0;
     uint32_t    c;
+    uint32_t    y;
+    int         lines = 0;
 
     if ( !initialized )
         return;
-    
+
+    if ( x1 >= VIDEO_X_RESOLUTION )
+        x1 = VIDEO_X_RESOLUTION - 1;
+    if ( y1 >= VIDEO_Y_RESOLUTION )
+        y1 = VIDEO_Y_RESOLUTION - 1;
+
+    if ( x0 > x1 || y0 > y1 )
+    {
+        if ( callback )
+            callback();
+        return;
+    }
+
     c = color ? (0xffff0000) : (0x00000000);
 
-    for ( i = 0; i < VIDEO_Y_RESOLUTION; i++ )
-        for ( j = 0; j < 36; j++)
-            video_buffer[i][j + ACTIVE_VIDEO_OFFSET] = c;
+    /* Wait for a running fill before reusing its line table
+     */
+    video_fill_wait();
+
+#if (VIDEO_RUN_PLANE == 1)
+    /* Dynamic plane rows are filled with a span each, or emptied
+     * by a full width clear, with no DMA
+     */
+    if ( draw_plane_dynamic )
+    {
+        if ( !color && x0 == 0 && x1 == (VIDEO_X_RESOLUTION - 1) && y0 == 0 && y1 == (VIDEO_Y_RESOLUTION - 1) )
+            runs_clear();
+        else
+        {
+            for ( y = y0; y <= y1; y++ )
+            {
+                if ( !color && x0 == 0 && x1 == (VIDEO_X_RESOLUTION - 1) )
+                    runs_clear_row(y);
+                else
+                    runs_span(y, x0, (x1 + 1), (color ? SET : CLEAR));
+            }
+        }
+
+        if ( callback )
+            callback();
+        return;
+    }
+#endif
+
+    /* Track dynamic plane rows with content,
+     * a full width clear removes the row from scanout merging
+     */
+    if ( draw_plane_dynamic )
+    {
+        for ( y = y0; y <= y1; y++ )
+        {
+            if ( color )
+                dynamic_row_used[y] = 1;
+            else if ( x0 == 0 && x1 == (VIDEO_X_RESOLUTION - 1) )
+                dynamic_row_used[y] = 0;
+        }
+    }
+
+    /* Whole words are [first_word, last_word],
+     * partial words on either side get a pixel mask.
+     */
+    first_word = (x0 + 15) >> 4;
+    last_word = ((x1 + 1) >> 4);
+
+    if ( (x0 >> 4) == (x1 >> 4) && ((x0 & 0x0f) || (x1 & 0x0f) != 0x0f) )
+    {
+        left_mask = (0xffffffff >> (x0 & 0x0f)) & (0xffffffff << (31 - (x1 & 0x0f))) & 0xffff0000;
+        first_word = last_word = 0;
+    }
+    else
+    {
+        if ( x0 & 0x0f )
+            left_mask = (0xffffffff >> (x0 & 0x0f)) & 0xffff0000;
+        if ( (x1 & 0x0f) != 0x0f )
+            right_mask = 0xffffffff << (31 - (x1 & 0x0f));
+    }
+
+    for ( y = y0; y <= y1; y++ )
+    {
+        if ( left_mask )
+        {
+            if ( color )
+                draw_plane[y][(x0 >> 4) + ACTIVE_VIDEO_OFFSET] |= left_mask;
+            else
+                draw_plane[y][(x0 >> 4) + ACTIVE_VIDEO_OFFSET] &= ~left_mask;
+        }
+
+        if ( right_mask )
+        {
+            if ( color )
+                draw_plane[y][(x1 >> 4) + ACTIVE_VIDEO_OFFSET] |= right_mask;
+            else
+                draw_plane[y][(x1 >> 4) + ACTIVE_VIDEO_OFFSET] &= ~right_mask;
+        }
+    }
+
+    if ( last_word > first_word )
+    {
+        for ( y = y0; y <= y1; y++ )
+            fill_lines[lines++] = &draw_plane[y][first_word + ACTIVE_VIDEO_OFFSET];
+    }
+
+    fill_lines[lines] = 0;
+
+    io_dma_fill(fill_lines, (last_word - first_word), c, callback);
+}
+
+/***************************************************************
+ * video_fill_busy()
+ * 
+ *  Check if a DMA fill is in progress.
+ * 
+ *  Param:  none
+ *  return: True while a fill is in progress
+ * 
+ */
+int video_fill_busy(void)
+{
+    return io_dma_fill_busy();
+}
+
+/***************************************************************
+ * video_fill_wait()
+ * 
+ *  Wait for a DMA fill to complete.
+ * 
+ *  Param:  none
+ *  return: none
+ * 
+ */
+void video_fill_wait(void)
+{
+    while ( io_dma_fill_busy() )
+        ;
 }
 
 /***************************************************************
@@ -117,7 +593,7 @@ void video_clear_screen(int color)
  *  return: none
  * 
  */
-void video_set_pixel(uint32_t x, uint32_t y)
+void __not_in_flash_func(video_set_pixel)(uint32_t x, uint32_t y)
 {
     uint32_t    word_index;
     uint32_t    bit_index;
@@ -139,12 +615,23 @@ void video_set_pixel(uint32_t x, uint32_t y)
     while ( !io_is_vert_retrace() ) 
     ;
 
+#if (VIDEO_RUN_PLANE == 1)
+    if ( draw_plane_dynamic )
+    {
+        runs_span(y, x, (x + 1), pixel_action);
+        return;
+    }
+#endif
+
+    if ( draw_plane_dynamic && pixel_action != CLEAR )
+        dynamic_row_used[y] = 1;
+
     if ( pixel_action == CLEAR )
-        video_buffer[y][word_index] &= 0xfffffffe << bit_index;
+        draw_plane[y][word_index] &= ~(0x00000001 << bit_index);
     else if ( pixel_action == SET )
-        video_buffer[y][word_index] |= 0x00000001 << bit_index;
+        draw_plane[y][word_index] |= 0x00000001 << bit_index;
     else
-        video_buffer[y][word_index] ^= 0x00000001 << bit_index;
+        draw_plane[y][word_index] ^= 0x00000001 << bit_index;
 }
 
 /* ----------------------------------------------------------------------------
@@ -153,33 +640,137 @@ void video_set_pixel(uint32_t x, uint32_t y)
  *  Draw a line in foreground color 'white'
  *  between coordinates (X0,Y0)-(X1,Y1) using Bresenham's line algorithm
  *  Safe to use coordinate outside screen, function will draw clipped lines.
+ *  The line is clipped before drawing: the first visible step and its error
+ *  term are computed directly, so the drawing loop does not test the screen
+ *  bounds, and a line that is entirely off screen is not stepped through.
  *
  *  Param:  Line start-end (X0,Y0)-(X1,Y1) coordinates
  *  return: none
  * 
  */
-void video_line(uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1)
+void __not_in_flash_func(video_line)(uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1)
 {
-    int     dx, sx;
-    int     dy, sy;
-    int     err, e2;
+    int32_t     sx0 = (int32_t)x0, sy0 = (int32_t)y0;
+    int32_t     sx1 = (int32_t)x1, sy1 = (int32_t)y1;
+    int32_t     dx, sx;
+    int32_t     dy, sy;
+    int32_t     err;
+    int32_t     y, y_first;
+    int32_t     first, minor, count;
+    int32_t     row_step;
+    uint32_t    clear, toggle;
+    uint32_t   *word;
+    uint32_t    bit;
 
     if ( !initialized )
         return;
-    
-    dx = abs(x1-x0);
-    sx = x0<x1 ? 1 : -1;
-    dy = abs(y1-y0);
-    sy = y0<y1 ? 1 : -1;
-    err = (dx>dy ? dx : -dy)/2;
 
-    for(;;)
+    /* Ends within +/-VIDEO_LINE_COORD_MAX, so the lengths and clipping products fit
+     */
+    if ( (x0 + VIDEO_LINE_COORD_MAX) > (2 * VIDEO_LINE_COORD_MAX) ||
+         (y0 + VIDEO_LINE_COORD_MAX) > (2 * VIDEO_LINE_COORD_MAX) ||
+         (x1 + VIDEO_LINE_COORD_MAX) > (2 * VIDEO_LINE_COORD_MAX) ||
+         (y1 + VIDEO_LINE_COORD_MAX) > (2 * VIDEO_LINE_COORD_MAX) )
+    {
+        return;
+    }
+
+    dx = abs(sx1 - sx0);
+    sx = sx0 < sx1 ? 1 : -1;
+    dy = abs(sy1 - sy0);
+    sy = sy0 < sy1 ? 1 : -1;
+
+    /* Position and error term of the first visible step
+     */
+    if ( dx > dy )
+    {
+        count = video_line_clip(sx0, sx, dx, VIDEO_X_RESOLUTION, sy0, sy, dy, VIDEO_Y_RESOLUTION, &first, &minor);
+        x0 = sx0 + (sx * first);
+        y = sy0 + (sy * minor);
+        err = (dx / 2) - (first * dy) + (minor * dx);
+    }
+    else
+    {
+        count = video_line_clip(sy0, sy, dy, VIDEO_Y_RESOLUTION, sx0, sx, dx, VIDEO_X_RESOLUTION, &first, &minor);
+        x0 = sx0 + (sx * minor);
+        y = sy0 + (sy * first);
+        err = (dy / 2) - (first * dx) + (minor * dy);
+    }
+
+    if ( count == 0 )
+        return;
+
+#if (VIDEO_RUN_PLANE == 1)
+    if ( draw_plane_dynamic )
+    {
+        while ( !io_is_vert_retrace() ) 
+        ;
+
+        video_line_runs(x0, y, dx, sx, dy, sy, err, count);
+        return;
+    }
+#endif
+
+    video_action_masks(&clear, &toggle);
+
+    word = &draw_plane[y][(x0 >> 4) + ACTIVE_VIDEO_OFFSET];
+    bit = 0x80000000 >> (x0 & 0x0000000f);
+    row_step = sy * SCAN_LINE_BUF_LEN;
+    y_first = y;
+
+    while ( !io_is_vert_retrace() ) 
+    ;
+
+    /* A step along the major axis every time, and along the minor axis
+     * when the error term is below the minor axis length
+     */
+    if ( dx > dy )
+    {
+        for (;;)
+        {
+            *word = (*word & ~(bit & clear)) ^ (bit & toggle);
+            if ( --count == 0 )
+                break;
+
+            if ( err < dy )
+            {
+                err += dx - dy;
+                word += row_step;
+                y += sy;
+            }
+            else
+                err -= dy;
+
+            video_step_x(&word, &bit, sx);
+        }
+    }
+    else
+    {
+        for (;;)
+        {
+            *word = (*word & ~(bit & clear)) ^ (bit & toggle);
+            if ( --count == 0 )
+                break;
+
+            if ( err < dx )
+            {
+                err += dy - dx;
+                video_step_x(&word, &bit, sx);
+            }
+            else
+                err -= dx;
+
+            word += row_step;
+            y += sy;
+        }
+    }
+
+    if ( draw_plane_dynamic && pixel_action != CLEAR )
     {
-        video_set_pixel(x0, y0);
-        if (x0==x1 && y0==y1) break;
-        e2 = err;
-        if (e2 >-dx) { err -= dy; x0 += sx; }
-        if (e2 < dy) { err += dx; y0 += sy; }
+        if ( y < y_first )
+            memset(&dynamic_row_used[y], 1, y_first - y + 1);
+        else
+            memset(&dynamic_row_used[y_first], 1, y - y_first + 1);
     }
 }
 
@@ -240,63 +831,115 @@ void  video_flood_fill(uint32_t x0, uint32_t y0)
  *  to the function. The bitmap is painted according to the pixel action.
  *  The function uses the bit_blit_t structure col_count to determine bytes per row.
  *  A new row is started when col_count is reached.
+ *  The bitmap is clipped to the screen once, before drawing, and its visible
+ *  pixels are collected into frame buffer words that are written one at a time.
  *
  *  Param:  Starting point o place bit map, bit map parameters, and color.
  *  return: none
  * 
  */
-void video_bit_blit(uint32_t x0, uint32_t y0, bit_blit_t *bitmap)
+void __not_in_flash_func(video_bit_blit)(uint32_t x0, uint32_t y0, const bit_blit_t *bitmap)
 {
-    int         full_bytes_in_row;
-    int         pixels_in_last_byte;
-    int         row;
-    int         col;
-    int         byte;
-    uint8_t    *bitmap_pattern;
-    uint8_t     pattern;
+    int32_t     x = (int32_t)x0;
+    int32_t     y = (int32_t)y0;
+    int64_t     first, end;
+    int32_t     col_first, col_end;
+    int32_t     row_first, row_end;
+    uint32_t    row_bytes;
+    uint32_t    clear, toggle;
+    int         flag_rows;
+    const uint8_t  *bitmap_pattern;
     uint8_t     bit_mask;
+    uint32_t   *word;
+    uint32_t    bit;
+    uint32_t    pixels;
+    uint32_t    drawn;
 
     if ( !initialized )
         return;
 
-    if ( bitmap->col_count == 0 ||
-         bitmap->row_count == 0 )
-         return;
+    /* Clip in 64 bits, a bitmap can start 2^31 pixels off screen. The visible
+     * columns and rows are within the bitmap, so their bounds fit 32 bits.
+     */
+    first = (x < 0) ? -(int64_t)x : 0;
+    end = (int64_t)VIDEO_X_RESOLUTION - x;
+    if ( end > bitmap->col_count )
+        end = bitmap->col_count;
+    if ( first >= end )
+        return;
+
+    col_first = (int32_t)first;
+    col_end = (int32_t)end;
+
+    first = (y < 0) ? -(int64_t)y : 0;
+    end = (int64_t)VIDEO_Y_RESOLUTION - y;
+    if ( end > bitmap->row_count )
+        end = bitmap->row_count;
+    if ( first >= end )
+        return;
+
+    row_first = (int32_t)first;
+    row_end = (int32_t)end;
 
-    full_bytes_in_row = (bitmap->col_count - 1) >> 3;
-    pixels_in_last_byte = bitmap->col_count - (full_bytes_in_row * 8);
+    row_bytes = (bitmap->col_count + 7) >> 3;
+    x += col_first;
 
-    bitmap_pattern = bitmap->bitmap;
+    video_action_masks(&clear, &toggle);
+    flag_rows = draw_plane_dynamic && pixel_action != CLEAR;
 
-    for ( row = 0; row < bitmap->row_count; row++ )
+    while ( !io_is_vert_retrace() ) 
+    ;
+
+#if (VIDEO_RUN_PLANE == 1)
+    if ( draw_plane_dynamic )
+    {
+        for ( int32_t row = row_first; row < row_end; row++ )
+            video_blit_runs(x, (y + row), &bitmap->bitmap[(uint32_t)row * row_bytes], col_first, col_end);
+        return;
+    }
+#endif
+
+    for ( int32_t row = row_first; row < row_end; row++ )
     {
-        col = 0;
+        bitmap_pattern = &bitmap->bitmap[((uint32_t)row * row_bytes) + (col_first >> 3)];
+        bit_mask = 0b10000000 >> (col_first & 7);
+
+        word = &draw_plane[y + row][(x >> 4) + ACTIVE_VIDEO_OFFSET];
+        bit = 0x80000000 >> (x & 0x0000000f);
+        pixels = 0;
+        drawn = 0;
 
-        for ( byte = 0; byte < full_bytes_in_row; byte++ )
+        for ( int32_t col = col_first; col < col_end; col++ )
         {
-            pattern = *bitmap_pattern++;
-            for (int i = 0, bit_mask = 0b10000000; i < 8; i++ )
+            if ( *bitmap_pattern & bit_mask )
+                pixels |= bit;
+
+            bit_mask >>= 1;
+            if ( bit_mask == 0 )
             {
-                if ( bit_mask & pattern )
-                    video_set_pixel(x0 + col, y0 + row);
-                
-                bit_mask >>= 1;
-                col++;
+                bit_mask = 0b10000000;
+                bitmap_pattern++;
             }
-        }
 
-        if ( pixels_in_last_byte )
-        {
-            pattern = *bitmap_pattern++;
-            for (int i = 0, bit_mask = 0b10000000; i < pixels_in_last_byte; i++ )
+            bit >>= 1;
+            if ( bit == 0x00008000 )
             {
-                if ( bit_mask & pattern )
-                    video_set_pixel(x0 + col, y0 + row);
-                
-                bit_mask >>= 1;
-                col++;
+                *word = (*word & ~(pixels & clear)) ^ (pixels & toggle);
+                drawn |= pixels;
+                pixels = 0;
+                bit = 0x80000000;
+                word++;
             }
         }
+
+        if ( pixels )
+        {
+            *word = (*word & ~(pixels & clear)) ^ (pixels & toggle);
+            drawn |= pixels;
+        }
+
+        if ( flag_rows && drawn )
+            dynamic_row_used[y + row] = 1;
     }
 }
 
@@ -318,29 +961,807 @@ void video_write_text(uint32_t x, uint32_t y, char *text)
 }
 
 /* ----------------------------------------------------------------------------
- * video_get_x_res()
+ * video_rle_image()
  *
- *  Return X axis resolution in pixels
- *
- *  Param:  none
- *  return: X axis resolution in pixels
- * 
- */
-uint32_t video_get_x_res(void)
-{
-    return (VIDEO_X_RESOLUTION - 1);
-}
-
-/* ----------------------------------------------------------------------------
- * video_get_y_res()
+ *  Decode a run length encoded image into the drawing plane.
+ *  Runs are written a frame buffer word at a time: a masked store for
+ *  a partial word at either end of a run, and whole word stores between
+ *  them, so a long run costs one store per 16 pixels.
+ *  The image replaces what is under it. The left edge is rounded down
+ *  to a word boundary, and the image must fit on the screen.
  *
- *  Return Y axis resolution in pixels
+ *  Param:  Top left corner, image
+ *  return: 0 if drawn, -1 if the image does not fit or its data is short
  *
- *  Param:  none
- *  return: Y axis resolution in pixels
- * 
  */
-uint32_t video_get_y_res(void)
+int __not_in_flash_func(video_rle_image)(uint32_t x0, uint32_t y0, const video_rle_t *image)
 {
-    return (VIDEO_Y_RESOLUTION - 1);
-}
\ No newline at end of file
+    const uint8_t  *data = image->data;
+    const uint8_t  *data_end = image->data + image->size;
+    uint32_t       *line;
+    uint32_t        color = 0;
+    uint32_t        run, count;
+    uint32_t        x = 0, y = 0;
+    uint32_t        first, last, stop;
+    uint32_t        mask;
+    int             shift;
+
+    if ( !initialized )
+        return -1;
+
+    x0 &= ~0x0f;
+
+    if ( image->col_count == 0 || image->row_count == 0 ||
+         (x0 + image->col_count) > VIDEO_X_RESOLUTION ||
+         (y0 + image->row_count) > VIDEO_Y_RESOLUTION )
+        return -1;
+
+    /* Do not race a running fill into the same plane
+     */
+    video_fill_wait();
+
+    while ( y < image->row_count )
+    {
+        run = 0;
+        shift = 0;
+
+        do
+        {
+            if ( data == data_end )
+                return -1;
+
+            run |= (uint32_t)(*data & 0x7f) << shift;
+            shift += 7;
+        }
+        while ( *data++ & 0x80 );
+
+        /* Write the run, up to the end of the image row at a time
+         */
+        while ( run && y < image->row_count )
+        {
+            count = image->col_count - x;
+            if ( count > run )
+                count = run;
+
+            run -= count;
+            first = x;
+            last = x + count;
+            x = last;
+
+#if (VIDEO_RUN_PLANE == 1)
+            if ( draw_plane_dynamic )
+                runs_span((y0 + y), (x0 + first), (x0 + last), (color ? SET : CLEAR));
+            else
+#endif
+            {
+                line = &draw_plane[y0 + y][(x0 >> 4) + ACTIVE_VIDEO_OFFSET];
+
+                if ( draw_plane_dynamic )
+                    dynamic_row_used[y0 + y] = 1;
+
+                if ( first & 0x0f )
+                {
+                    stop = (last < ((first | 0x0f) + 1)) ? (last & 0x0f) : 16;
+                    mask = (PIXEL_FIELD_MASK >> (first & 0x0f)) & ~(PIXEL_FIELD_MASK >> stop);
+                    line[first >> 4] = (line[first >> 4] & ~mask) | (color & mask);
+                    first = (first & ~0x0f) + stop;
+                }
+
+                for ( ; (first + 16) <= last; first += 16 )
+                    line[first >> 4] = color;
+
+                if ( first < last )
+                {
+                    mask = PIXEL_FIELD_MASK & ~(PIXEL_FIELD_MASK >> (last - first));
+                    line[first >> 4] = (line[first >> 4] & ~mask) | (color & mask);
+                }
+            }
+
+            if ( x == image->col_count )
+            {
+                x = 0;
+                y++;
+            }
+        }
+
+        color ^= PIXEL_FIELD_MASK;
+    }
+
+    return 0;
+}
+
+/* ----------------------------------------------------------------------------
+ * video_get_x_res()
+ *
+ *  Return X axis resolution in pixels
+ *
+ *  Param:  none
+ *  return: X axis resolution in pixels
+ * 
+ */
+uint32_t video_get_x_res(void)
+{
+    return (VIDEO_X_RESOLUTION - 1);
+}
+
+/* ----------------------------------------------------------------------------
+ * video_get_y_res()
+ *
+ *  Return Y axis resolution in pixels
+ *
+ *  Param:  none
+ *  return: Y axis resolution in pixels
+ * 
+ */
+uint32_t video_get_y_res(void)
+{
+    return (VIDEO_Y_RESOLUTION - 1);
+}
+
+/***************************************************************
+ * video_map_rows()
+ *
+ *  Show frame buffer rows on a range of display rows, each frame buffer
+ *  row on 'repeat' display rows. Rows past the bottom of the frame buffer
+ *  wrap to the top. For example, a scrolled playfield under a fixed score
+ *  line, or every row shown twice for a double height screen.
+ *  The scan line interrupt reads the table, change it during vertical retrace.
+ *
+ *  Param:  First display row, count of display rows, first frame buffer row,
+ *          display rows per frame buffer row (1 or more)
+ *  return: none
+ *
+ */
+void video_map_rows(uint32_t display_row, uint32_t count, uint32_t row, uint32_t repeat)
+{
+    uint32_t    shown = 0;
+
+    if ( display_row >= VIDEO_Y_RESOLUTION )
+        return;
+
+    if ( count > (VIDEO_Y_RESOLUTION - display_row) )
+        count = VIDEO_Y_RESOLUTION - display_row;
+
+    if ( repeat == 0 )
+        repeat = 1;
+
+    row %= VIDEO_Y_RESOLUTION;
+
+    for ( uint32_t i = 0; i < count; i++ )
+    {
+        row_table[display_row + i] = row;
+
+        if ( ++shown == repeat )
+        {
+            shown = 0;
+            if ( ++row == VIDEO_Y_RESOLUTION )
+                row = 0;
+        }
+    }
+}
+
+/***************************************************************
+ * video_set_row_offset()
+ *
+ *  Set a row offset added to the frame buffer row of every display row,
+ *  from the next field. A positive offset scrolls the screen up,
+ *  rows wrap around. For vertical scrolling of the whole screen, or shaking.
+ *
+ *  Param:  Offset in rows
+ *  return: none
+ *
+ */
+void video_set_row_offset(int offset)
+{
+    offset %= (int)VIDEO_Y_RESOLUTION;
+    if ( offset < 0 )
+        offset += VIDEO_Y_RESOLUTION;
+
+    row_offset = offset;
+}
+
+/***************************************************************
+ * video_reset_rows()
+ *
+ *  Show every frame buffer row on its own display row, with no offset.
+ *
+ *  Param:  none
+ *  return: none
+ *
+ */
+void video_reset_rows(void)
+{
+    video_map_rows(0, VIDEO_Y_RESOLUTION, 0, 1);
+    row_offset = 0;
+}
+
+#if (VIDEO_TILE_MAP == 1)
+/***************************************************************
+ * video_tile_set()
+ *
+ *  Select the tile set of the tile map. A tile is 8 bytes, a byte
+ *  per pixel row with the leftmost pixel in the MSB, normally a const
+ *  table in flash generated by tools/img2sprite.py. The set is copied
+ *  to RAM, so scanout does not read flash. Map cells with a tile past
+ *  the end of a smaller set are set to tile 0 first.
+ *
+ *  Param:  Tile set, tile count (1 to VIDEO_TILES)
+ *  return: 0 if set, -1 for a bad tile set
+ *
+ */
+int video_tile_set(const uint8_t *tiles, uint32_t count)
+{
+    if ( tiles == 0 || count == 0 || count > VIDEO_TILES )
+        return -1;
+
+    if ( count < tile_count )
+    {
+        for ( int r = 0; r < TILE_ROWS; r++ )
+            for ( int c = 0; c < TILE_COLS; c++ )
+                if ( tile_map[r][c] >= count )
+                    tile_map[r][c] = 0;
+    }
+
+    memcpy(tile_data, tiles, (count * VIDEO_TILE_SIZE));
+    tile_count = count;
+
+    return 0;
+}
+
+/***************************************************************
+ * video_tile_put()
+ *
+ *  Place a tile in a map cell.
+ *
+ *  Param:  Cell column and row, tile
+ *  return: none
+ *
+ */
+void video_tile_put(uint32_t col, uint32_t row, uint32_t tile)
+{
+    if ( col >= TILE_COLS || row >= TILE_ROWS || tile >= tile_count )
+        return;
+
+    tile_map[row][col] = tile;
+}
+
+/***************************************************************
+ * video_tile_fill()
+ *
+ *  Place a tile in a block of map cells, clipped to the map.
+ *  Filling with a blank tile erases the block.
+ *
+ *  Param:  Top left cell column and row, block columns and rows, tile
+ *  return: none
+ *
+ */
+void video_tile_fill(uint32_t col, uint32_t row, uint32_t cols, uint32_t rows, uint32_t tile)
+{
+    if ( col >= TILE_COLS || row >= TILE_ROWS || tile >= tile_count )
+        return;
+
+    if ( cols > (TILE_COLS - col) )
+        cols = TILE_COLS - col;
+    if ( rows > (TILE_ROWS - row) )
+        rows = TILE_ROWS - row;
+
+    for ( uint32_t r = row; r < (row + rows); r++ )
+        memset(&tile_map[r][col], tile, cols);
+}
+
+/***************************************************************
+ * video_tile_block()
+ *
+ *  Place a block of consecutive tiles, in rows left to right, in
+ *  map cells, clipped to the map. An image cut into tiles by
+ *  tools/img2sprite.py is drawn with one call.
+ *
+ *  Param:  Top left cell column and row, first tile, block columns and rows
+ *  return: 0 if placed, -1 if the block is past the end of the tile set
+ *
+ */
+int video_tile_block(uint32_t col, uint32_t row, uint32_t first, uint32_t cols, uint32_t rows)
+{
+    uint32_t    tile;
+
+    if ( (first + (cols * rows)) > tile_count )
+        return -1;
+
+    for ( uint32_t r = 0; r < rows; r++ )
+    {
+        tile = first + (r * cols);
+
+        for ( uint32_t c = 0; c < cols; c++, tile++ )
+        {
+            if ( (col + c) < TILE_COLS && (row + r) < TILE_ROWS )
+                tile_map[row + r][col + c] = tile;
+        }
+    }
+
+    return 0;
+}
+#endif
+/***************************************************************
+ * video_sprite_set()
+ *
+ *  Set a sprite's image. The sprite is disabled until
+ *  video_sprite_enable() is called.
+ *
+ *  The image and mask are copied to RAM, so scanout does not read
+ *  them from flash.
+ *
+ *  Param:  Sprite number, image (up to VIDEO_SPRITE_MAX_COLS wide and
+ *          VIDEO_SPRITE_MAX_ROWS tall), optional mask of pixels
+ *          hidden under the sprite in the image's format, and priority.
+ *          Higher priority sprites are drawn over lower priority sprites.
+ *  return: 0 if set, -1 for a bad sprite number or image
+ *
+ */
+int video_sprite_set(int sprite, const bit_blit_t *image, const uint8_t *mask, uint8_t priority)
+{
+    uint32_t    row_bytes;
+
+    if ( sprite < 0 || sprite >= VIDEO_SPRITES )
+        return -1;
+
+    if ( !image || image->col_count == 0 || image->col_count > VIDEO_SPRITE_MAX_COLS ||
+         image->row_count == 0 || image->row_count > VIDEO_SPRITE_MAX_ROWS )
+        return -1;
+
+    sprites[sprite].enabled = 0;
+
+    row_bytes = (image->col_count + 7) >> 3;
+
+    for ( uint32_t row = 0; row < image->row_count; row++ )
+    {
+        sprite_bits[sprite][row] = video_sprite_row(&image->bitmap[row * row_bytes], image->col_count);
+        if ( mask )
+            sprite_mask[sprite][row] = video_sprite_row(&mask[row * row_bytes], image->col_count);
+    }
+
+    sprites[sprite].bits = sprite_bits[sprite];
+    sprites[sprite].mask = mask ? sprite_mask[sprite] : NULL;
+    sprites[sprite].row_count = image->row_count;
+    sprites[sprite].priority = priority;
+
+    return 0;
+}
+
+/***************************************************************
+ * video_sprite_move()
+ *
+ *  Move a sprite. Takes effect at the start of the next field.
+ *
+ *  Param:  Sprite number, and top left corner coordinates
+ *  return: none
+ *
+ */
+void video_sprite_move(int sprite, int x, int y)
+{
+    if ( sprite < 0 || sprite >= VIDEO_SPRITES )
+        return;
+
+    sprites[sprite].x = x;
+    sprites[sprite].y = y;
+}
+
+/***************************************************************
+ * video_sprite_enable()
+ *
+ *  Show or hide a sprite. Takes effect at the start of the next field.
+ *
+ *  Param:  Sprite number, and 1 to show or 0 to hide
+ *  return: none
+ *
+ */
+void video_sprite_enable(int sprite, int enable)
+{
+    if ( sprite < 0 || sprite >= VIDEO_SPRITES || !sprites[sprite].bits )
+        return;
+
+    sprites[sprite].enabled = (enable != 0);
+}
+
+/***************************************************************
+ * video_sprite_cost()
+ *
+ *  Measure scan line composition cost: the fixed cost of merging
+ *  a static and a dynamic plane row into a line buffer, and the cost
+ *  of merging one worst case (full width, masked, unaligned) sprite.
+ *  With VIDEO_RUN_PLANE the dynamic plane cost is the expansion of the runs
+ *  in the first row, and with VIDEO_TILE_MAP the static plane cost is the
+ *  expansion of the first row of tiles.
+ *
+ *  Param:  Pointers to line cost and per-sprite cost in CPU cycles
+ *  return: none
+ *
+ */
+void video_sprite_cost(uint32_t *line_cycles, uint32_t *sprite_cycles)
+{
+    static const uint32_t   solid[1] = { 0xffffffff };
+
+    uint32_t    line[SCAN_LINE_BUF_LEN];
+    sprite_t    test = { solid, solid, 1, 8, 0, 0, 1 };
+    uint32_t    start;
+
+    start = io_get_cycles();
+#if (VIDEO_TILE_MAP == 1)
+    video_tile_row(0, line);
+#elif (VIDEO_RUN_PLANE == 1)
+    for ( int w = ACTIVE_VIDEO_OFFSET; w < (ACTIVE_VIDEO_OFFSET + VIDEO_ACTIVE_WORDS); w++ )
+        line[w] = static_plane[0][w];
+#endif
+#if (VIDEO_RUN_PLANE == 1)
+    runs_expand(0, line);
+#elif (VIDEO_TILE_MAP == 1)
+    for ( int w = ACTIVE_VIDEO_OFFSET; w < (ACTIVE_VIDEO_OFFSET + VIDEO_ACTIVE_WORDS); w++ )
+        line[w] |= dynamic_plane[0][w];
+#else
+    for ( int w = ACTIVE_VIDEO_OFFSET; w < (ACTIVE_VIDEO_OFFSET + VIDEO_ACTIVE_WORDS); w++ )
+        line[w] = static_plane[0][w] | dynamic_plane[0][w];
+#endif
+    *line_cycles = io_get_cycles() - start;
+
+    start = io_get_cycles();
+    for ( int i = 0; i < VIDEO_SPRITES; i++ )
+        video_merge_sprite(line, &test, 0);
+    *sprite_cycles = (io_get_cycles() - start) / VIDEO_SPRITES;
+}
+
+/***************************************************************
+ * video_get_line_stats()
+ *
+ *  Return scan line composition statistics since the last call.
+ *
+ *  Param:  Pointer to statistics
+ *  return: none
+ *
+ */
+void video_get_line_stats(video_line_stats_t *stats)
+{
+    *stats = line_stats;
+
+    line_stats.max_cycles = 0;
+    line_stats.max_sprites = 0;
+}
+
+/* ----------------------------------------------------------------------------
+ * video_sprite_row()
+ *
+ *  Read one row of a 1 bit per pixel image.
+ *
+ *  Param:  Row data, and pixels in the row (1 to 32)
+ *  return: Row pixels, first pixel in the MSB
+ *
+ */
+static uint32_t video_sprite_row(const uint8_t *data, uint32_t col_count)
+{
+    uint32_t    bits = 0;
+    uint32_t    bytes = (col_count + 7) >> 3;
+
+    for ( uint32_t i = 0; i < 4; i++ )
+    {
+        bits <<= 8;
+        if ( i < bytes )
+            bits |= data[i];
+    }
+
+    if ( col_count < 32 )
+        bits &= ~(0xffffffff >> col_count);
+
+    return bits;
+}
+
+/* ----------------------------------------------------------------------------
+ * video_merge_sprite()
+ *
+ *  Merge one row of a sprite into a scan line.
+ *  A sprite row spans up to 3 pixel words, the row is placed
+ *  in a 48 bit window over those words, first pixel at bit 47.
+ *
+ *  Param:  Scan line, sprite, and sprite row
+ *  return: none
+ *
+ */
+static void __not_in_flash_func(video_merge_sprite)(uint32_t *line, const sprite_t *sprite, int row)
+{
+    uint32_t            bits, mask;
+    uint64_t            bits_window, mask_window;
+    uint32_t            word_bits, word_mask;
+    int                 x = sprite->x;
+    int                 word;
+
+    bits = sprite->bits[row];
+    mask = sprite->mask ? sprite->mask[row] : 0;
+
+    /* Clip at left edge of screen, right edge is clipped by word count
+     */
+    if ( x < 0 )
+    {
+        if ( x <= -VIDEO_SPRITE_MAX_COLS )
+            return;
+        bits <<= -x;
+        mask <<= -x;
+        x = 0;
+    }
+
+    if ( x >= VIDEO_X_RESOLUTION )
+        return;
+
+    bits_window = (uint64_t)bits << (16 - (x & 15));
+    mask_window = (uint64_t)mask << (16 - (x & 15));
+    word = (x >> 4) + ACTIVE_VIDEO_OFFSET;
+
+    for ( int i = 0; i < 3 && word < (ACTIVE_VIDEO_OFFSET + VIDEO_ACTIVE_WORDS); i++, word++ )
+    {
+        word_bits = (uint32_t)((bits_window << (16 * i)) >> 16) & PIXEL_FIELD_MASK;
+        word_mask = (uint32_t)((mask_window << (16 * i)) >> 16) & PIXEL_FIELD_MASK;
+
+        line[word] = (line[word] & ~word_mask) | word_bits;
+    }
+}
+
+/* ----------------------------------------------------------------------------
+ * video_claim_line()
+ *
+ *  Copy a frame buffer row into the next line buffer for composition,
+ *  a word at a time so the copy runs from RAM with the scan line interrupt.
+ *
+ *  Param:  Frame buffer row
+ *  return: Line buffer
+ *
+ */
+static uint32_t* __not_in_flash_func(video_claim_line)(const uint32_t *line)
+{
+    uint32_t   *buffer = &line_buffer[line_buffer_index][0];
+
+    for ( int w = ACTIVE_VIDEO_OFFSET; w < (ACTIVE_VIDEO_OFFSET + VIDEO_ACTIVE_WORDS); w++ )
+        buffer[w] = line[w];
+
+    line_buffer_index ^= 1;
+
+    return buffer;
+}
+
+#if (VIDEO_TILE_MAP == 1)
+/* ----------------------------------------------------------------------------
+ * video_tile_row()
+ *
+ *  Expand a frame buffer row of the tile map into the pixel fields
+ *  of a scan line, two tile bytes per word.
+ *
+ *  Param:  Frame buffer row, scan line of SCAN_LINE_BUF_LEN words
+ *  return: none
+ *
+ */
+static void __not_in_flash_func(video_tile_row)(uint32_t row, uint32_t *line)
+{
+    const uint8_t  *tiles = &tile_data[row % VIDEO_TILE_SIZE];
+    const uint8_t  *map = &tile_map[row / VIDEO_TILE_SIZE][0];
+    uint32_t       *pixels = &line[ACTIVE_VIDEO_OFFSET];
+
+    for ( int w = 0; w < VIDEO_ACTIVE_WORDS; w++, map += 2 )
+        pixels[w] = ((uint32_t)tiles[map[0] * VIDEO_TILE_SIZE] << 24) |
+                    ((uint32_t)tiles[map[1] * VIDEO_TILE_SIZE] << 16);
+}
+#endif
+
+/* ----------------------------------------------------------------------------
+ * video_line_clip()
+ *
+ *  Clip the steps of a Bresenham line to the screen.
+ *  Step k of the line, from 0 to the major axis length 'da', is at a0 + sa * k
+ *  on the major axis and at b0 + sb * n(k) on the minor axis, where n(k) is the
+ *  count of minor axis steps so far. The error term starts at da / 2 and stays
+ *  in [0, da), so n(k) = ceil((k * db - da / 2) / da), and the steps that
+ *  reach a minor axis position follow from it without walking the line.
+ *  Line ends are within VIDEO_LINE_COORD_MAX, so the products fit 32 bits
+ *  and the divisions are the hardware divider, not a 64 bit library call.
+ *
+ *  Param:  Major axis start, direction, length and screen resolution,
+ *          minor axis start, direction, length and screen resolution,
+ *          first visible step and minor axis steps to it
+ *  return: Count of visible steps, 0 if the line is off screen
+ *
+ */
+static int32_t __not_in_flash_func(video_line_clip)(int32_t a0, int32_t sa, int32_t da, int32_t res_a,
+                                                    int32_t b0, int32_t sb, int32_t db, int32_t res_b,
+                                                    int32_t *first, int32_t *minor)
+{
+    int32_t     lo = 0, hi = da;
+    int32_t     n_lo, n_hi;
+    int32_t     num;
+
+    /* Steps on screen along the major axis
+     */
+    if ( sa > 0 )
+    {
+        if ( lo < -a0 )
+            lo = -a0;
+        if ( hi > res_a - 1 - a0 )
+            hi = res_a - 1 - a0;
+    }
+    else
+    {
+        if ( lo < a0 - (res_a - 1) )
+            lo = a0 - (res_a - 1);
+        if ( hi > a0 )
+            hi = a0;
+    }
+
+    /* Minor axis steps on screen, then the major axis steps that have them
+     */
+    if ( sb > 0 )
+    {
+        n_lo = -b0;
+        n_hi = res_b - 1 - b0;
+    }
+    else
+    {
+        n_lo = b0 - (res_b - 1);
+        n_hi = b0;
+    }
+
+    if ( n_hi < 0 || n_lo > db )
+        return 0;
+
+    if ( db > 0 )
+    {
+        if ( n_lo > 0 && lo < ((((n_lo - 1) * da) + (da / 2)) / db) + 1 )
+            lo = ((((n_lo - 1) * da) + (da / 2)) / db) + 1;
+        if ( n_hi < db && hi > ((n_hi * da) + (da / 2)) / db )
+            hi = ((n_hi * da) + (da / 2)) / db;
+    }
+
+    if ( lo > hi )
+        return 0;
+
+    num = (lo * db) - (da / 2);
+
+    *first = lo;
+    *minor = (num <= 0) ? 0 : (num + da - 1) / da;
+
+    return hi - lo + 1;
+}
+
+/* ----------------------------------------------------------------------------
+ * video_step_x()
+ *
+ *  Move a frame buffer word and pixel bit one pixel left or right,
+ *  skipping the sync field in the low half of the words.
+ *
+ *  Param:  Word pointer, pixel bit, direction
+ *  return: none
+ *
+ */
+static inline void video_step_x(uint32_t **word, uint32_t *bit, int32_t sx)
+{
+    if ( sx > 0 )
+    {
+        *bit >>= 1;
+        if ( *bit == 0x00008000 )
+        {
+            *bit = 0x80000000;
+            (*word)++;
+        }
+    }
+    else
+    {
+        *bit <<= 1;
+        if ( *bit == 0 )
+        {
+            *bit = 0x00010000;
+            (*word)--;
+        }
+    }
+}
+
+/* ----------------------------------------------------------------------------
+ * video_action_masks()
+ *
+ *  Masks that apply the pixel action to the pixels set in 'p' as
+ *  word = (word & ~(p & clear)) ^ (p & toggle), without a branch per pixel.
+ *
+ *  Param:  Clear and toggle masks
+ *  return: none
+ *
+ */
+static inline void video_action_masks(uint32_t *clear, uint32_t *toggle)
+{
+    *clear = (pixel_action == FLIP) ? 0 : 0xffffffff;
+    *toggle = (pixel_action == CLEAR) ? 0 : 0xffffffff;
+}
+
+#if (VIDEO_RUN_PLANE == 1)
+/* ----------------------------------------------------------------------------
+ * video_line_runs()
+ *
+ *  Draw the visible steps of a clipped line into the run plane, with the
+ *  pixel action. The pixels of a line on one row are next to each other,
+ *  so a row gets one span instead of a span per pixel.
+ *
+ *  Param:  First visible pixel, major and minor axis lengths and directions,
+ *          error term at the first visible step, count of visible steps
+ *  return: none
+ *
+ */
+static void __not_in_flash_func(video_line_runs)(int32_t x, int32_t y, int32_t dx, int32_t sx, int32_t dy, int32_t sy,
+                                                 int32_t err, int32_t count)
+{
+    int32_t     x_first = x;
+
+    if ( dx > dy )
+    {
+        while ( --count )
+        {
+            if ( err < dy )
+            {
+                err += dx - dy;
+                runs_span(y, (sx > 0 ? x_first : x), (sx > 0 ? x : x_first) + 1, pixel_action);
+                y += sy;
+                x += sx;
+                x_first = x;
+            }
+            else
+            {
+                err -= dy;
+                x += sx;
+            }
+        }
+
+        runs_span(y, (sx > 0 ? x_first : x), (sx > 0 ? x : x_first) + 1, pixel_action);
+    }
+    else
+    {
+        for (;;)
+        {
+            runs_span(y, x, (x + 1), pixel_action);
+            if ( --count == 0 )
+                break;
+
+            if ( err < dx )
+            {
+                err += dy - dx;
+                x += sx;
+            }
+            else
+                err -= dx;
+
+            y += sy;
+        }
+    }
+}
+
+/* ----------------------------------------------------------------------------
+ * video_blit_runs()
+ *
+ *  Draw one clipped bitmap row into the run plane, with the pixel action
+ *  on each run of '1' bits.
+ *
+ *  Param:  Screen position of the first visible column, bitmap row data,
+ *          first visible column and column after the last
+ *  return: none
+ *
+ */
+static void __not_in_flash_func(video_blit_runs)(uint32_t x, uint32_t y, const uint8_t *data, uint32_t col_first, uint32_t col_end)
+{
+    uint32_t    start = 0;
+    int         in_run = 0;
+    int         pixel;
+
+    for ( uint32_t col = col_first; col < col_end; col++ )
+    {
+        pixel = (data[col >> 3] & (0b10000000 >> (col & 7))) != 0;
+
+        if ( pixel && !in_run )
+            start = col;
+        else if ( !pixel && in_run )
+            runs_span(y, (x + start - col_first), (x + col - col_first), pixel_action);
+
+        in_run = pixel;
+    }
+
+    if ( in_run )
+        runs_span(y, (x + start - col_first), (x + col_end - col_first), pixel_action);
+}
+#endif